@@ -1,22 +1,44 @@
+#include "memory_ledger.hh"
 #include "tcp_connection.hh"
+#include "tcp_demux.hh"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <random>
 #include <string>
 
 using namespace std;
 using namespace std::chrono;
 
 constexpr size_t len = 100 * 1024 * 1024;
+constexpr size_t timed_len = 10 * 1024 * 1024;
 
-void move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segments, const bool reorder) {
+void move_segments(TCPConnection &x,
+                   TCPConnection &y,
+                   vector<TCPSegment> &segments,
+                   const bool reorder,
+                   const function<bool()> &drop = [] { return false; },
+                   const bool coalesce = false,
+                   const bool batch = false) {
     while (not x.segments_out().empty()) {
-        segments.emplace_back(move(x.segments_out().front()));
+        if (not drop()) {
+            segments.emplace_back(move(x.segments_out().front()));
+        }
         x.segments_out().pop();
     }
-    if (reorder) {
+    if (coalesce) {
+        segments = TCPSegment::coalesce(move(segments));
+    }
+    if (batch) {
+        if (reorder) {
+            reverse(segments.begin(), segments.end());
+        }
+        y.segments_received(segments);
+    } else if (reorder) {
         for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
             y.segment_received(move(*it));
         }
@@ -28,11 +50,24 @@ void move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segme
     segments.clear();
 }
 
-void main_loop(const bool reorder) {
-    TCPConfig config;
+//! \param[in] label printed after the kind of result
+//! \param[in] reorder deliver each batch of segments from x to y in reverse order
+//! \param[in] config the configuration of both connections
+//! \param[in] timed let only 1 ms pass per exchange and report the goodput over that simulated time,
+//! instead of the CPU-limited throughput
+//! \param[in] loss_rate fraction of the segments from x to y to drop
+//! \param[in] batch hand each batch of segments to TCPConnection::segments_received at once,
+//! instead of to segment_received one by one
+void main_loop(const string &label,
+               const bool reorder,
+               const TCPConfig &config = {},
+               const bool timed = false,
+               const double loss_rate = 0,
+               const bool batch = false) {
     TCPConnection x{config}, y{config};
 
-    string string_to_send(len, 'x');
+    const size_t stream_len = timed ? timed_len : len;
+    string string_to_send(stream_len, 'x');
     for (auto &ch : string_to_send) {
         ch = rand();
     }
@@ -43,8 +78,15 @@ void main_loop(const bool reorder) {
 
     bool x_closed = false;
 
+    mt19937 loss_rd{0};
+    bernoulli_distribution loss{loss_rate};
+    const auto drop = [&] { return loss(loss_rd); };
+    const size_t ms_per_exchange = timed ? 1 : 1000;
+    size_t elapsed_ms = 0;
+    size_t segments_from_y = 0;
+
     string string_received;
-    string_received.reserve(len);
+    string_received.reserve(stream_len);
 
     const auto first_time = high_resolution_clock::now();
 
@@ -52,7 +94,9 @@ void main_loop(const bool reorder) {
         // write input into x
         while (bytes_to_send.size() and x.remaining_outbound_capacity()) {
             const auto want = min(x.remaining_outbound_capacity(), bytes_to_send.size());
-            const auto written = x.write(string(bytes_to_send.str().substr(0, want)));
+            Buffer chunk = bytes_to_send;
+            chunk.remove_suffix(bytes_to_send.size() - want);
+            const auto written = x.write(move(chunk));
             if (want != written) {
                 throw runtime_error("want = " + to_string(want) + ", written = " + to_string(written));
             }
@@ -66,8 +110,9 @@ void main_loop(const bool reorder) {
 
         // exchange segments between x and y but in reverse order
         vector<TCPSegment> segments;
-        move_segments(x, y, segments, reorder);
-        move_segments(y, x, segments, false);
+        move_segments(x, y, segments, reorder, drop, config.gro, batch);
+        segments_from_y += y.segments_out().size();
+        move_segments(y, x, segments, false, [] { return false; }, false, batch);
 
         // read output from y
         const auto available_output = y.inbound_stream().buffer_size();
@@ -76,8 +121,9 @@ void main_loop(const bool reorder) {
         }
 
         // time passes
-        x.tick(1000);
-        y.tick(1000);
+        x.tick(ms_per_exchange);
+        y.tick(ms_per_exchange);
+        elapsed_ms += ms_per_exchange;
     };
 
     while (not y.inbound_stream().eof()) {
@@ -92,21 +138,177 @@ void main_loop(const bool reorder) {
 
     const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
 
-    const auto gigabits_per_second = len * 8.0 / double(duration);
+    const auto gigabits_per_second = stream_len * 8.0 / double(duration);
 
     cout << fixed << setprecision(2);
-    cout << "CPU-limited throughput" << (reorder ? " with reordering: " : "                : ") << gigabits_per_second
-         << " Gbit/s\n";
+    if (timed) {
+        const auto megabits_per_second = stream_len * 8.0 / 1000 / double(elapsed_ms);
+        cout << "Goodput " << label << megabits_per_second << " Mbit/s at 1 ms per round trip ("
+             << x.fast_retransmits() << " fast retransmits)\n";
+    } else {
+        cout << "CPU-limited throughput " << label << gigabits_per_second << " Gbit/s (" << segments_from_y
+             << " segments from the receiver)\n";
+    }
 
     while (x.active() or y.active()) {
         loop();
     }
 }
 
+// deliver segments between two TCPDemuxes until neither has anything left to send
+void exchange(TCPDemux &a, TCPDemux &b) {
+    while (not a.segments_out().empty() or not b.segments_out().empty()) {
+        for (auto [from, to] : {make_pair(&a, &b), make_pair(&b, &a)}) {
+            while (not from->segments_out().empty()) {
+                auto &[flow, seg] = from->segments_out().front();
+                to->segment_received(flow.reversed(), seg);
+                from->segments_out().pop();
+            }
+        }
+    }
+}
+
+//! \param[in] connections number of concurrent connections between one client and one server TCPDemux
+void demux_loop(const size_t connections) {
+    TCPConfig config;
+    config.recv_capacity = config.send_capacity = 4096;
+    TCPDemux client, server;
+    server.listen(80, config, connections);
+    MemoryLedger &ledger = MemoryLedger::global();
+    const size_t base_memory = ledger.used();
+    ledger.reset_high_watermark();
+
+    vector<FourTuple> flows;
+    for (size_t i = 0; i < connections; i++) {
+        flows.push_back({0x0a000000 + static_cast<uint32_t>(i >> 16), static_cast<uint16_t>(i), 0x0b000001, 80});
+    }
+    const auto us_per_connection = [&](const auto start) {
+        return double(duration_cast<nanoseconds>(high_resolution_clock::now() - start).count()) / 1000 / connections;
+    };
+
+    // handshakes
+    auto start = high_resolution_clock::now();
+    for (const auto &flow : flows) {
+        client.connect(config, flow);
+    }
+    exchange(client, server);
+    size_t accepted = 0;
+    while (server.accept().has_value()) {
+        accepted++;
+    }
+    const auto handshake_us = us_per_connection(start);
+    if (accepted != connections) {
+        throw runtime_error("accepted " + to_string(accepted) + " of " + to_string(connections) + " connections");
+    }
+
+    // one request and one response on every connection
+    start = high_resolution_clock::now();
+    const string request(100, 'q'), response(1000, 'r');
+    for (const auto &flow : flows) {
+        client.write(flow, Buffer{string(request)});
+    }
+    exchange(client, server);
+    for (const auto &flow : flows) {
+        if (server.read(flow.reversed(), request.size()) != request) {
+            throw runtime_error("request went astray");
+        }
+        server.write(flow.reversed(), Buffer{string(response)});
+    }
+    exchange(client, server);
+    for (const auto &flow : flows) {
+        if (client.read(flow, response.size()) != response) {
+            throw runtime_error("response went astray");
+        }
+    }
+    const auto exchange_us = us_per_connection(start);
+
+    // a tick with nothing to do, as for a server whose connections are mostly idle
+    start = high_resolution_clock::now();
+    server.tick(1);
+    const auto tick_us = us_per_connection(start);
+
+    // half of the connections close with a request the server has not read yet: they have no timers,
+    // so idle ticks should cost no more than before
+    const size_t closing = connections / 2;
+    for (size_t i = 0; i < closing; i++) {
+        client.write(flows[i], Buffer{string(request)});
+        client.end_input_stream(flows[i]);
+    }
+    exchange(client, server);
+    for (size_t i = 0; i < closing; i++) {
+        server.end_input_stream(flows[i].reversed());
+    }
+    exchange(client, server);
+    server.tick(1);  // the connections see that both streams have finished, and close
+    constexpr size_t idle_ticks = 100;
+    start = high_resolution_clock::now();
+    for (size_t i = 0; i < idle_ticks; i++) {
+        server.tick(1);
+    }
+    const auto closed_tick_us = us_per_connection(start) / idle_ticks;
+
+    cout << fixed << setprecision(2) << connections << " connections through one TCPDemux: " << handshake_us
+         << " us per handshake, " << exchange_us << " us per request/response, " << tick_us * 1000
+         << " ns per connection per tick (" << closed_tick_us * 1000
+         << " with half closed and unread), " << (ledger.high_watermark() - base_memory) / connections
+         << " bytes buffered per connection at peak\n";
+
+    // reading what the closed connections left removes them
+    for (size_t i = 0; i < closing; i++) {
+        if (server.read(flows[i].reversed(), request.size()) != request) {
+            throw runtime_error("request went astray");
+        }
+    }
+    if (server.size() != connections - closing) {
+        throw runtime_error("closed connections should be removed once read");
+    }
+
+    for (size_t i = closing; i < connections; i++) {
+        client.end_input_stream(flows[i]);
+    }
+    exchange(client, server);
+    for (size_t i = closing; i < connections; i++) {
+        server.end_input_stream(flows[i].reversed());
+    }
+    exchange(client, server);
+    server.tick(1);
+    client.tick(10 * config.rt_timeout);
+}
+
 int main() {
     try {
-        main_loop(false);
-        main_loop(true);
+        // each batch of segments delivered one by one, and all at once with segments_received()
+        main_loop("                : ", false);
+        main_loop("batched         : ", false, {}, false, 0, true);
+        main_loop("with reordering : ", true);
+        main_loop("batched, reorder: ", true, {}, false, 0, true);
+        TCPConfig delayed_ack;
+        delayed_ack.delayed_ack_timeout = 40;
+        main_loop("with delayed ACK: ", false, delayed_ack);
+        TCPConfig gso;
+        gso.gso = true;
+        main_loop("with GSO        : ", false, gso);
+        TCPConfig gro;
+        gro.gro = true;
+        main_loop("with GRO        : ", false, gro);
+
+        // losses: without fast retransmit every loss costs a whole retransmission timeout
+        TCPConfig lossy;
+        lossy.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+        main_loop("with 1% loss, RTO only:        ", false, lossy, true, 0.01);
+        lossy.fast_retransmit = true;
+        main_loop("with 1% loss, fast retransmit: ", false, lossy, true, 0.01);
+        lossy.sack = true;
+        main_loop("with 1% loss, SACK:            ", false, lossy, true, 0.01);
+
+        // without window scaling at most 64 KiB can be in flight per round trip
+        TCPConfig large_window;
+        large_window.recv_capacity = large_window.send_capacity = 1024 * 1024;
+        main_loop("with a 1 MiB buffer, unscaled: ", false, large_window, true);
+        large_window.window_scaling = true;
+        main_loop("with a 1 MiB buffer, scaled:   ", false, large_window, true);
+
+        demux_loop(10000);
     } catch (const exception &e) {
         cerr << e.what() << "\n";
         return EXIT_FAILURE;
@@ -24,9 +24,26 @@ static void show_usage(const char *argv0, const char *msg) {
          << "                   In server mode, <host>:<port> is the address to bind.\n\n"
 
          << "   -w <winsz>      Use a window of <winsz> bytes                   " << TCPConfig::MAX_PAYLOAD_SIZE
-         << "\n\n"
-
-         << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
+         << "\n"
+         << "   -W              Window scaling, needed for -w above 65535       (off)\n"
+         << "   -A              Grow buffers to fit the connection (with -W -C) (fixed)\n\n"
+
+         << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n"
+         << "   -a              Adapt the timeout to the measured RTT           (fixed)\n"
+         << "   -f              Fast retransmit on three duplicate ACKs         (off)\n"
+         << "   -S              Selective acknowledgments (implies -f)          (off)\n"
+         << "   -T              Timestamps for RTT samples and PAWS             (off)\n"
+         << "   -D <ms>         Delay ACKs of in-order data by up to <ms>       (off)\n"
+         << "   -N              Use Nagle's algorithm for small writes          (off)\n"
+         << "   -P              Pace new data over the measured RTT             (off)\n"
+         << "   -G              Build super-segments, split just before sending (off)\n"
+         << "   -R              Coalesce bursts of received in-order segments   (off)\n\n"
+
+         << "   -m <mss>        Send at most <mss> payload bytes per segment    " << TCPConfig::MAX_PAYLOAD_SIZE << "\n"
+         << "   -J              Jumbo mode, same as -m " << TCPConfig::MAX_JUMBO_PAYLOAD_SIZE << "\n"
+         << "                   (the peer's MSS option still caps the segment size)\n\n"
+
+         << "   -C <algo>       Congestion control: none, reno or cubic         none\n\n"
 
          << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
          << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
@@ -68,6 +85,74 @@ static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv)
             c_fsm.rt_timeout = strtol(argv[curr + 1], nullptr, 0);
             curr += 2;
 
+        } else if (strncmp("-a", argv[curr], 3) == 0) {
+            c_fsm.adaptive_rto = true;
+            curr += 1;
+
+        } else if (strncmp("-f", argv[curr], 3) == 0) {
+            c_fsm.fast_retransmit = true;
+            curr += 1;
+
+        } else if (strncmp("-S", argv[curr], 3) == 0) {
+            c_fsm.sack = true;
+            curr += 1;
+
+        } else if (strncmp("-T", argv[curr], 3) == 0) {
+            c_fsm.timestamps = true;
+            curr += 1;
+
+        } else if (strncmp("-D", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -D requires one argument.");
+            c_fsm.delayed_ack_timeout = strtol(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
+        } else if (strncmp("-N", argv[curr], 3) == 0) {
+            c_fsm.nagle = true;
+            curr += 1;
+
+        } else if (strncmp("-P", argv[curr], 3) == 0) {
+            c_fsm.pacing = true;
+            curr += 1;
+
+        } else if (strncmp("-G", argv[curr], 3) == 0) {
+            c_fsm.gso = true;
+            curr += 1;
+
+        } else if (strncmp("-R", argv[curr], 3) == 0) {
+            c_fsm.gro = true;
+            curr += 1;
+
+        } else if (strncmp("-W", argv[curr], 3) == 0) {
+            c_fsm.window_scaling = true;
+            curr += 1;
+
+        } else if (strncmp("-A", argv[curr], 3) == 0) {
+            c_fsm.buffer_autotuning = true;
+            curr += 1;
+
+        } else if (strncmp("-m", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -m requires one argument.");
+            c_fsm.max_payload_size = strtol(argv[curr + 1], nullptr, 0);
+            curr += 2;
+
+        } else if (strncmp("-J", argv[curr], 3) == 0) {
+            c_fsm.max_payload_size = TCPConfig::MAX_JUMBO_PAYLOAD_SIZE;
+            curr += 1;
+
+        } else if (strncmp("-C", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -C requires one argument.");
+            if (strcmp("reno", argv[curr + 1]) == 0) {
+                c_fsm.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+            } else if (strcmp("cubic", argv[curr + 1]) == 0) {
+                c_fsm.congestion_control = TCPConfig::CongestionAlgorithm::Cubic;
+            } else if (strcmp("none", argv[curr + 1]) == 0) {
+                c_fsm.congestion_control = TCPConfig::CongestionAlgorithm::None;
+            } else {
+                show_usage(argv[0], "ERROR: -C must be one of none, reno or cubic.");
+                exit(1);
+            }
+            curr += 2;
+
         } else if (strncmp("-Lu", argv[curr], 3) == 0) {
             check_argc(argc, argv, curr, "ERROR: -Lu requires one argument.");
             float lossrate = strtof(argv[curr + 1], nullptr);
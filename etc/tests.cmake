@@ -17,10 +17,15 @@ add_test(NAME t_recv_special         COMMAND recv_special)
 add_test(NAME t_send_connect         COMMAND send_connect)
 add_test(NAME t_send_transmit        COMMAND send_transmit)
 add_test(NAME t_send_retx            COMMAND send_retx)
+add_test(NAME t_send_fast_retx       COMMAND send_fast_retx)
+add_test(NAME t_send_in_flight       COMMAND send_in_flight)
+add_test(NAME t_send_pacing         COMMAND send_pacing)
 add_test(NAME t_send_window          COMMAND send_window)
 add_test(NAME t_send_ack             COMMAND send_ack)
 add_test(NAME t_send_close           COMMAND send_close)
 add_test(NAME t_send_extra           COMMAND send_extra)
+add_test(NAME t_send_congestion      COMMAND send_congestion)
+add_test(NAME t_send_rto             COMMAND send_rto)
 
 add_test(NAME t_strm_reassem_single      COMMAND fsm_stream_reassembler_single)
 add_test(NAME t_strm_reassem_seq         COMMAND fsm_stream_reassembler_seq)
@@ -30,12 +35,27 @@ add_test(NAME t_strm_reassem_many        COMMAND fsm_stream_reassembler_many)
 add_test(NAME t_strm_reassem_overlapping COMMAND fsm_stream_reassembler_overlapping)
 add_test(NAME t_strm_reassem_win         COMMAND fsm_stream_reassembler_win)
 add_test(NAME t_strm_reassem_cap         COMMAND fsm_stream_reassembler_cap)
+add_test(NAME t_strm_reassem_fast_path   COMMAND fsm_stream_reassembler_fast_path)
 
 add_test(NAME t_byte_stream_construction COMMAND byte_stream_construction)
 add_test(NAME t_byte_stream_one_write    COMMAND byte_stream_one_write)
 add_test(NAME t_byte_stream_two_writes   COMMAND byte_stream_two_writes)
 add_test(NAME t_byte_stream_capacity     COMMAND byte_stream_capacity)
 add_test(NAME t_byte_stream_many_writes  COMMAND byte_stream_many_writes)
+add_test(NAME t_byte_stream_spans       COMMAND byte_stream_spans)
+add_test(NAME t_byte_stream_chunked     COMMAND byte_stream_chunked)
+
+add_test(NAME t_tcp_mss               COMMAND tcp_mss)
+add_test(NAME t_tcp_sack              COMMAND tcp_sack)
+add_test(NAME t_tcp_wscale            COMMAND tcp_wscale)
+add_test(NAME t_tcp_timestamps        COMMAND tcp_timestamps)
+add_test(NAME t_tcp_demux             COMMAND tcp_demux)
+add_test(NAME t_timer_wheel           COMMAND timer_wheel)
+add_test(NAME t_tcp_batch             COMMAND tcp_batch)
+add_test(NAME t_tcp_autotune          COMMAND tcp_autotune)
+add_test(NAME t_memory_ledger         COMMAND memory_ledger)
+add_test(NAME t_tcp_gso               COMMAND tcp_gso)
+add_test(NAME t_tcp_gro               COMMAND tcp_gro)
 
 add_test(NAME t_webget               COMMAND "${PROJECT_SOURCE_DIR}/tests/webget_t.sh")
 
@@ -56,6 +76,8 @@ add_test(NAME t_connect              COMMAND fsm_connect_relaxed)
 add_test(NAME ec_listen              COMMAND fsm_listen)
 add_test(NAME t_listen               COMMAND fsm_listen_relaxed)
 add_test(NAME t_winsize              COMMAND fsm_winsize)
+add_test(NAME t_delayed_ack          COMMAND fsm_delayed_ack)
+add_test(NAME t_nagle                COMMAND fsm_nagle)
 add_test(NAME ec_retx                COMMAND fsm_retx)
 add_test(NAME t_retx                 COMMAND fsm_retx_relaxed)
 add_test(NAME t_retx_win             COMMAND fsm_retx_win)
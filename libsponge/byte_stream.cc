@@ -1,7 +1,9 @@
 #include "byte_stream.hh"
 
+#include <algorithm>
 #include <cstddef>
-#include <iterator>
+#include <cstring>
+#include <stdexcept>
 #include <unistd.h>
 
 // Dummy implementation of a flow-controlled in-memory byte stream.
@@ -16,8 +18,19 @@ void DUMMY_CODE(Targs &&.../* unused */) {}
 
 using namespace std;
 
-ByteStream::ByteStream(const size_t capacity)
-    : _byte_stream()
+// 向上取整到 2 的幂次, 这样环形下标只需要一次按位与
+static size_t ring_size_for(const size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    return size;
+}
+
+ByteStream::ByteStream(const size_t capacity, const Storage storage)
+    : _storage(storage)
+    , _ring()
+    , _mask(0)
     , _capacity(capacity)
     , _byte_written_size(0)
     , _byte_read_size(0)
@@ -28,25 +41,124 @@ ByteStream::ByteStream(const size_t capacity)
 size_t ByteStream::write(const string &data) {
     if (input_ended())
         return 0;
-    size_t written_size = 0;
-    written_size = min(data.size(), _capacity - _byte_stream.size());
-    _byte_stream.insert(_byte_stream.end(), data.begin(), data.begin() + written_size);
-    _byte_written_size += written_size;
+    const size_t written_size = min(data.size(), remaining_capacity());
+    // 什么也没写入时不必分配环形缓冲区
+    if (written_size == 0) {
+        return 0;
+    }
+    if (_storage == Storage::Chunked) {
+        push_chunk(data.substr(0, written_size));
+        _byte_written_size += written_size;
+        recharge();
+        return written_size;
+    }
+    size_t copied = 0;
+    for (const auto &span : writable_spans()) {
+        const size_t n = min(span.iov_len, written_size - copied);
+        memcpy(span.iov_base, data.data() + copied, n);
+        copied += n;
+    }
+    commit_write(written_size);
+    return written_size;
+}
+
+// Chunked 模式下直接保存 Buffer 的引用, 超出容量的部分从尾部截掉
+size_t ByteStream::write(Buffer data) {
+    if (input_ended())
+        return 0;
+    const size_t written_size = min(data.size(), remaining_capacity());
+    if (written_size == 0) {
+        return 0;
+    }
+    data.remove_suffix(data.size() - written_size);
+    if (_storage == Storage::Chunked) {
+        push_chunk(std::move(data));
+        _byte_written_size += written_size;
+        recharge();
+        return written_size;
+    }
+    const string_view view = data.str();
+    size_t copied = 0;
+    for (const auto &span : writable_spans()) {
+        const size_t n = min(span.iov_len, written_size - copied);
+        memcpy(span.iov_base, view.data() + copied, n);
+        copied += n;
+    }
+    commit_write(written_size);
     return written_size;
 }
 
+array<iovec, 2> ByteStream::writable_spans() {
+    if (_storage == Storage::Chunked) {
+        return {iovec{nullptr, 0}, iovec{nullptr, 0}};
+    }
+    if (_ring.empty()) {
+        resize_ring(ring_size_for(_capacity));
+    }
+    const size_t free_size = remaining_capacity();
+    const size_t tail = _byte_written_size & _mask;
+    const size_t first = min(free_size, _ring.size() - tail);
+    return {iovec{_ring.data() + tail, first}, iovec{_ring.data(), free_size - first}};
+}
+
+void ByteStream::commit_write(const size_t len) {
+    if (len > remaining_capacity() or ((_storage == Storage::Chunked or _input_end) and len > 0)) {
+        throw out_of_range("ByteStream::commit_write");
+    }
+    _byte_written_size += len;
+}
+
+array<string_view, 2> ByteStream::readable_spans(const size_t len) const {
+    const size_t read_size = min(len, buffer_size());
+    if (_storage == Storage::Chunked) {
+        array<string_view, 2> spans{};
+        size_t remaining = read_size;
+        for (size_t i = 0; i < spans.size() and i < _chunks.size() and remaining > 0; i++) {
+            spans[i] = _chunks[i].str().substr(0, remaining);
+            remaining -= spans[i].size();
+        }
+        return spans;
+    }
+    const size_t head = _byte_read_size & _mask;
+    const size_t first = min(read_size, _ring.size() - head);
+    return {string_view{_ring.data() + head, first}, string_view{_ring.data(), read_size - first}};
+}
+
 //! \param[in] len bytes will be copied from the output side of the buffer
 string ByteStream::peek_output(const size_t len) const {
-    size_t read_size = min(len, _byte_stream.size());
-    string read_output(_byte_stream.begin(), _byte_stream.begin() + read_size);
+    const size_t read_size = min(len, buffer_size());
+    string read_output;
+    read_output.reserve(read_size);
+    if (_storage == Storage::Chunked) {
+        for (auto it = _chunks.begin(); it != _chunks.end() and read_output.size() < read_size; ++it) {
+            read_output.append(it->str().substr(0, read_size - read_output.size()));
+        }
+        return read_output;
+    }
+    const auto spans = readable_spans(read_size);
+    read_output.append(spans[0]).append(spans[1]);
     return read_output;
 }
 
 //! \param[in] len bytes will be removed from the output side of the buffer
 void ByteStream::pop_output(const size_t len) {
-    size_t read_size = min(len, _byte_stream.size());
-    _byte_stream.erase(_byte_stream.begin(), _byte_stream.begin() + read_size);
-    _byte_read_size += read_size;
+    const size_t pop_size = min(len, buffer_size());
+    if (_storage == Storage::Chunked) {
+        size_t remaining = pop_size;
+        while (remaining > 0) {
+            Buffer &front = _chunks.front();
+            if (remaining < front.size()) {
+                front.remove_prefix(remaining);
+                break;
+            }
+            remaining -= front.size();
+            pop_chunk();
+        }
+        _byte_read_size += pop_size;
+        recharge();
+        return;
+    }
+    _byte_read_size += pop_size;
 }
 
 //! Read (i.e., copy and then pop) the next "len" bytes of the stream
@@ -58,13 +170,39 @@ std::string ByteStream::read(const size_t len) {
     return read_output;
 }
 
+//! \param[in] len bytes will be popped and returned
+//! \returns a BufferList that shares storage with the written Buffers (chunked stream) or owns a copy (ring)
+BufferList ByteStream::read_buffers(const size_t len) {
+    if (_storage == Storage::Ring) {
+        return BufferList{read(len)};
+    }
+    const size_t read_size = min(len, buffer_size());
+    BufferList ret;
+    size_t remaining = read_size;
+    while (remaining > 0) {
+        Buffer &front = _chunks.front();
+        if (remaining < front.size()) {
+            Buffer slice = front;
+            slice.remove_suffix(front.size() - remaining);
+            ret.append(slice);
+            front.remove_prefix(remaining);
+            break;
+        }
+        remaining -= front.size();
+        ret.append(pop_chunk());
+    }
+    _byte_read_size += read_size;
+    recharge();
+    return ret;
+}
+
 void ByteStream::end_input() { _input_end = true; }
 
 bool ByteStream::input_ended() const { return _input_end; }
 
-size_t ByteStream::buffer_size() const { return _byte_stream.size(); }
+size_t ByteStream::buffer_size() const { return _byte_written_size - _byte_read_size; }
 
-bool ByteStream::buffer_empty() const { return _byte_stream.empty(); }
+bool ByteStream::buffer_empty() const { return buffer_size() == 0; }
 
 bool ByteStream::eof() const { return _input_end && buffer_empty(); }
 
@@ -72,4 +210,56 @@ size_t ByteStream::bytes_written() const { return _byte_written_size; }
 
 size_t ByteStream::bytes_read() const { return _byte_read_size; }
 
-size_t ByteStream::remaining_capacity() const { return _capacity - _byte_stream.size(); }
+size_t ByteStream::remaining_capacity() const { return _capacity - buffer_size(); }
+
+// Chunked 模式只有容量限制, 没有缓冲区需要调整
+void ByteStream::set_capacity(const size_t capacity) {
+    _capacity = max(capacity, buffer_size());
+    if (_storage == Storage::Ring and not _ring.empty() and ring_size_for(_capacity) != _ring.size()) {
+        resize_ring(ring_size_for(_capacity));
+    }
+}
+
+void ByteStream::release_memory() {
+    if (_storage == Storage::Ring and buffer_empty()) {
+        vector<char>().swap(_ring);
+        _mask = 0;
+        recharge();
+    }
+}
+
+size_t ByteStream::memory_usage() const { return _storage == Storage::Ring ? _ring.size() : _chunk_storage; }
+
+void ByteStream::push_chunk(Buffer chunk) {
+    if (_chunks.empty() or not _chunks.back().shares_storage(chunk)) {
+        _chunk_storage += chunk.storage_size();
+    }
+    _chunks.push_back(std::move(chunk));
+}
+
+Buffer ByteStream::pop_chunk() {
+    Buffer chunk = std::move(_chunks.front());
+    _chunks.pop_front();
+    // 同一个字符串的最后一个切片取出后才不再计入
+    if (_chunks.empty() or not _chunks.front().shares_storage(chunk)) {
+        _chunk_storage -= chunk.storage_size();
+    }
+    return chunk;
+}
+
+void ByteStream::resize_ring(const size_t ring_size) {
+    vector<char> ring(ring_size);
+    const size_t mask = ring_size - 1;
+    size_t index = _byte_read_size;
+    for (const auto &span : readable_spans()) {
+        // 新的环形缓冲区也可能绕回, 最多再分两段
+        const size_t offset = index & mask;
+        const size_t first = min(span.size(), ring_size - offset);
+        memcpy(ring.data() + offset, span.data(), first);
+        memcpy(ring.data(), span.data() + first, span.size() - first);
+        index += span.size();
+    }
+    _ring.swap(ring);
+    _mask = mask;
+    recharge();
+}
@@ -1,8 +1,15 @@
 #ifndef SPONGE_LIBSPONGE_BYTE_STREAM_HH
 #define SPONGE_LIBSPONGE_BYTE_STREAM_HH
 
+#include "buffer.hh"
+#include "memory_ledger.hh"
+
+#include <array>
 #include <deque>
 #include <string>
+#include <string_view>
+#include <sys/uio.h>
+#include <vector>
 
 //! \brief An in-order byte stream.
 
@@ -10,6 +17,13 @@
 //! side.  The byte stream is finite: the writer can end the input,
 //! and then no more bytes can be written.
 class ByteStream {
+  public:
+    //! \brief How the stream holds the bytes that have been written but not yet read
+    enum class Storage {
+        Ring,     //!< copied into a fixed-size ring buffer (supports the writable-span interface)
+        Chunked,  //!< kept as the refcounted Buffer slices that were written (no copy for write(Buffer))
+    };
+
   private:
     // Your code here -- add private members as necessary.
 
@@ -19,16 +33,37 @@ class ByteStream {
     // different approaches.
 
     // 补充私有成员变量
-    std::deque<char> _byte_stream;
+    Storage _storage;
+    // 环形缓冲区, 大小向上取整到 2 的幂次, 读写位置由累计读写字节数与 _mask 相与得到
+    // 第一次写入时才分配, release_memory() 在缓冲区为空时释放
+    std::vector<char> _ring;
+    size_t _mask;
+    // Chunked 模式下按写入顺序保存的 Buffer 切片
+    std::deque<Buffer> _chunks{};
+    // _chunks 引用的字符串的总大小 (相邻的切片来自同一个字符串时只算一次), 即 Chunked 模式的 memory_usage()
+    // 切片只剩一部分时, 整个字符串仍然被它引用着, 所以按字符串而不是按切片计算
+    size_t _chunk_storage{0};
     size_t _capacity;
     size_t _byte_written_size;
     size_t _byte_read_size;
     bool _input_end;
     bool _error{};  //!< Flag indicating that the stream suffered an error.
+    // 计入 MemoryLedger 的内存, 即 memory_usage()
+    MemoryCharge _charge{};
+
+    // 重新分配 ring_size 大小的环形缓冲区, 已缓存的字节搬到新的位置
+    void resize_ring(const size_t ring_size);
+
+    // Chunked 模式下在尾部追加, 或从头部取出一个切片, 同时更新 _chunk_storage
+    void push_chunk(Buffer chunk);
+    Buffer pop_chunk();
+
+    // 占用的内存变化后更新 _charge
+    void recharge() { _charge.set(memory_usage()); }
 
   public:
     //! Construct a stream with room for `capacity` bytes.
-    ByteStream(const size_t capacity);
+    ByteStream(const size_t capacity, const Storage storage = Storage::Ring);
 
     //! \name "Input" interface for the writer
     //!@{
@@ -38,6 +73,11 @@ class ByteStream {
     //! \returns the number of bytes accepted into the stream
     size_t write(const std::string &data);
 
+    //! Write a Buffer into the stream. Write as many bytes as will fit, and return how many were written.
+    //! \note A chunked stream keeps a reference to (a prefix of) `data` instead of copying it.
+    //! \returns the number of bytes accepted into the stream
+    size_t write(Buffer data);
+
     //! \returns the number of additional bytes that the stream has space for
     size_t remaining_capacity() const;
 
@@ -48,6 +88,25 @@ class ByteStream {
     void set_error() { _error = true; }
     //!@}
 
+    //! \name Buffer sizing
+    //!@{
+
+    //! \brief Change the number of bytes the stream has room for (never below what is buffered)
+    //! \details A ring stream whose ring has been allocated moves the buffered bytes into a ring of the new size.
+    void set_capacity(const size_t capacity);
+
+    //! \returns the number of bytes the stream has room for, buffered or not
+    size_t capacity() const { return _capacity; }
+
+    //! \brief Free the ring while the stream is empty; the next write allocates it again
+    void release_memory();
+
+    //! \returns the bytes of memory held for buffering: the ring, or for a chunked stream the whole of every
+    //! string its slices keep alive (a slice of a larger Buffer, or a partly read chunk, holds all of it)
+    //! \note This is what the stream charges to MemoryLedger::global()
+    size_t memory_usage() const;
+    //!@}
+
     //! \name "Output" interface for the reader
     //!@{
 
@@ -62,6 +121,10 @@ class ByteStream {
     //! \returns a string
     std::string read(const size_t len);
 
+    //! Read (i.e., take and then pop) the next "len" bytes of the stream as a list of Buffers
+    //! \note A chunked stream returns slices of the Buffers that were written, without copying.
+    BufferList read_buffers(const size_t len);
+
     //! \returns `true` if the stream input has ended
     bool input_ended() const;
 
@@ -78,6 +141,32 @@ class ByteStream {
     bool eof() const;
     //!@}
 
+    //! \name Contiguous-span interface
+    //! Direct access to the free and buffered regions of the underlying ring, so that
+    //! callers can fill or drain the stream with [readv(2)](\ref man2::readv),
+    //! [writev(2)](\ref man2::writev) or `memcpy` instead of building a temporary std::string.
+    //!@{
+
+    //! \brief Free space at the tail of the stream, at most remaining_capacity() bytes in total
+    //! \note The second span is empty unless the free region wraps around the end of the ring.
+    //! Spans are invalidated by any call that writes to the stream. A chunked stream has no
+    //! ring, so both spans are empty; use write(Buffer) instead.
+    std::array<iovec, 2> writable_spans();
+
+    //! \brief Make `len` bytes previously filled in through writable_spans() readable
+    //! \throws std::out_of_range if `len` is more than remaining_capacity(), or the input has ended
+    void commit_write(const size_t len);
+
+    //! \brief Buffered bytes at the head of the stream, at most `len` bytes in total
+    //! \note The second span is empty unless the buffered region wraps around the end of the ring.
+    //! For a chunked stream the spans are the first two chunks, so they may hold fewer than `len`
+    //! bytes even when more are buffered. Spans are invalidated by any call that consumes from the stream.
+    std::array<std::string_view, 2> readable_spans(const size_t len = std::string::npos) const;
+
+    //! \brief Remove `len` bytes from the head of the stream (same as pop_output())
+    void consume(const size_t len) { pop_output(len); }
+    //!@}
+
     //! \name General accounting
     //!@{
 
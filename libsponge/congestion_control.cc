@@ -0,0 +1,131 @@
+#include "congestion_control.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+// RFC 6928 的初始窗口: 10 个 MSS
+static constexpr size_t INITIAL_WINDOW_SEGMENTS = 10;
+
+unique_ptr<CongestionControl> CongestionControl::make(const TCPConfig::CongestionAlgorithm algorithm,
+                                                      const size_t mss) {
+    switch (algorithm) {
+        case TCPConfig::CongestionAlgorithm::NewReno:
+            return make_unique<NewReno>(mss);
+        case TCPConfig::CongestionAlgorithm::Cubic:
+            return make_unique<Cubic>(mss);
+        case TCPConfig::CongestionAlgorithm::None:
+            break;
+    }
+    return make_unique<NoCongestionControl>(mss);
+}
+
+size_t NoCongestionControl::cwnd() const { return numeric_limits<size_t>::max(); }
+
+NewReno::NewReno(const size_t mss)
+    : CongestionControl(mss), _cwnd(INITIAL_WINDOW_SEGMENTS * mss), _ssthresh(numeric_limits<size_t>::max()) {}
+
+void NewReno::set_mss(const size_t mss) {
+    CongestionControl::set_mss(mss);
+    _cwnd = INITIAL_WINDOW_SEGMENTS * mss;
+}
+
+void NewReno::on_ack(const size_t acked_bytes, const uint64_t /* now_ms */) {
+    if (_cwnd < _ssthresh) {
+        // 慢启动: 按确认的字节数增长 (RFC 3465, 每个 ACK 最多 2 个 MSS)
+        _cwnd += min(acked_bytes, 2 * _mss);
+        return;
+    }
+    // 拥塞避免: 每确认一个窗口的字节, cwnd 增加一个 MSS
+    _bytes_acked += acked_bytes;
+    if (_bytes_acked >= _cwnd) {
+        _bytes_acked -= _cwnd;
+        _cwnd += _mss;
+    }
+}
+
+void NewReno::on_congestion_event(const size_t bytes_in_flight, const uint64_t /* now_ms */) {
+    _ssthresh = max(bytes_in_flight / 2, 2 * _mss);
+    _cwnd = _ssthresh;
+    _bytes_acked = 0;
+}
+
+void NewReno::on_timeout(const size_t bytes_in_flight) {
+    _ssthresh = max(bytes_in_flight / 2, 2 * _mss);
+    _cwnd = _mss;
+    _bytes_acked = 0;
+}
+
+Cubic::Cubic(const size_t mss)
+    : CongestionControl(mss), _cwnd(INITIAL_WINDOW_SEGMENTS), _ssthresh(numeric_limits<double>::infinity()) {}
+
+void Cubic::set_mss(const size_t mss) {
+    CongestionControl::set_mss(mss);
+    _cwnd = INITIAL_WINDOW_SEGMENTS;
+}
+
+void Cubic::on_rtt_sample(const uint64_t rtt_ms) {
+    if (_min_rtt == 0 or rtt_ms < _min_rtt) {
+        _min_rtt = max<uint64_t>(rtt_ms, 1);
+    }
+}
+
+void Cubic::on_ack(const size_t acked_bytes, const uint64_t now_ms) {
+    const double acked = static_cast<double>(acked_bytes) / _mss;
+    if (_cwnd < _ssthresh) {
+        _cwnd += min(acked, 2.0);
+        return;
+    }
+
+    if (not _in_epoch) {
+        // 新的增长周期: 以 _w_max 为平台, 求回到平台所需的时间 K
+        _in_epoch = true;
+        _epoch_start = now_ms;
+        _w_est = _cwnd;
+        if (_cwnd < _w_max) {
+            _k = cbrt((_w_max - _cwnd) / C);
+            _origin = _w_max;
+        } else {
+            _k = 0;
+            _origin = _cwnd;
+        }
+    }
+
+    // 目标窗口取一个 RTT 之后 W(t) 的值
+    const double t = static_cast<double>(now_ms - _epoch_start + _min_rtt) / 1000;
+    const double target = _origin + C * pow(t - _k, 3);
+    if (target > _cwnd) {
+        _cwnd += (target - _cwnd) / _cwnd * acked;
+    } else {
+        _cwnd += 0.01 / _cwnd * acked;
+    }
+
+    // Reno-friendly 区域: 不比同样条件下的 Reno 增长得慢
+    _w_est += 3 * (1 - BETA) / (1 + BETA) * acked / _cwnd;
+    _cwnd = max(_cwnd, _w_est);
+}
+
+void Cubic::reduce() {
+    // fast convergence: 窗口没有回到上次的 _w_max, 说明有新的流加入, 让出更多带宽
+    _w_max = _cwnd < _w_max ? _cwnd * (1 + BETA) / 2 : _cwnd;
+    _ssthresh = max(_cwnd * BETA, 2.0);
+    _in_epoch = false;
+}
+
+void Cubic::on_congestion_event(const size_t /* bytes_in_flight */, const uint64_t /* now_ms */) {
+    reduce();
+    _cwnd = _ssthresh;
+}
+
+void Cubic::on_timeout(const size_t /* bytes_in_flight */) {
+    reduce();
+    _cwnd = 1;
+}
+
+size_t Cubic::cwnd() const { return static_cast<size_t>(_cwnd * _mss); }
+
+size_t Cubic::ssthresh() const {
+    return isinf(_ssthresh) ? numeric_limits<size_t>::max() : static_cast<size_t>(_ssthresh * _mss);
+}
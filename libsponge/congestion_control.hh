@@ -0,0 +1,118 @@
+#ifndef SPONGE_LIBSPONGE_CONGESTION_CONTROL_HH
+#define SPONGE_LIBSPONGE_CONGESTION_CONTROL_HH
+
+#include "tcp_config.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+//! \brief The congestion-control algorithm of a TCPSender
+
+//! The sender never has more than min(receiver window, cwnd()) sequence numbers in
+//! flight, and reports the events that drive the algorithm: newly acknowledged bytes,
+//! round-trip-time samples, losses inferred from duplicate ACKs, and retransmission
+//! timeouts. Windows are counted in bytes of sequence space; times are the sender's
+//! own clock in milliseconds (the sum of its tick() calls).
+class CongestionControl {
+  protected:
+    size_t _mss;  //!< sender maximum segment size, in bytes
+
+  public:
+    //! \param[in] mss the sender maximum segment size used to scale the window
+    explicit CongestionControl(const size_t mss) : _mss(mss) {}
+    virtual ~CongestionControl() = default;
+
+    //! \brief Build the controller selected by `algorithm`
+    static std::unique_ptr<CongestionControl> make(const TCPConfig::CongestionAlgorithm algorithm, const size_t mss);
+
+    //! \brief The sender maximum segment size changed (before any data was sent); restart from the initial window
+    virtual void set_mss(const size_t mss) { _mss = mss; }
+
+    //! \brief An ACK acknowledged `acked_bytes` new sequence numbers at time `now_ms`
+    virtual void on_ack(const size_t acked_bytes, const uint64_t now_ms) = 0;
+
+    //! \brief A round-trip time was measured on a segment that was never retransmitted
+    virtual void on_rtt_sample(const uint64_t rtt_ms) { static_cast<void>(rtt_ms); }
+
+    //! \brief A segment was inferred lost while `bytes_in_flight` were outstanding (e.g. by duplicate ACKs)
+    virtual void on_congestion_event(const size_t bytes_in_flight, const uint64_t now_ms) = 0;
+
+    //! \brief The retransmission timer expired while `bytes_in_flight` were outstanding
+    virtual void on_timeout(const size_t bytes_in_flight) = 0;
+
+    //! \returns the congestion window, in bytes
+    virtual size_t cwnd() const = 0;
+
+    //! \returns the slow-start threshold, in bytes
+    virtual size_t ssthresh() const = 0;
+};
+
+//! \brief No congestion control: the window is limited only by the receiver
+class NoCongestionControl : public CongestionControl {
+  public:
+    using CongestionControl::CongestionControl;
+
+    void on_ack(const size_t, const uint64_t) override {}
+    void on_congestion_event(const size_t, const uint64_t) override {}
+    void on_timeout(const size_t) override {}
+    size_t cwnd() const override;
+    size_t ssthresh() const override { return cwnd(); }
+};
+
+//! \brief Slow start and additive-increase/multiplicative-decrease,
+//! as in [RFC 5681](\ref rfc::rfc5681) and [RFC 6582](\ref rfc::rfc6582)
+class NewReno : public CongestionControl {
+  private:
+    size_t _cwnd;
+    size_t _ssthresh;
+    size_t _bytes_acked{0};  //!< bytes acknowledged since cwnd last grew in congestion avoidance
+
+  public:
+    explicit NewReno(const size_t mss);
+
+    void set_mss(const size_t mss) override;
+    void on_ack(const size_t acked_bytes, const uint64_t now_ms) override;
+    void on_congestion_event(const size_t bytes_in_flight, const uint64_t now_ms) override;
+    void on_timeout(const size_t bytes_in_flight) override;
+    size_t cwnd() const override { return _cwnd; }
+    size_t ssthresh() const override { return _ssthresh; }
+};
+
+//! \brief CUBIC window growth, as in [RFC 9438](\ref rfc::rfc9438)
+
+//! After a loss the window follows W(t) = C * (t - K)^3 + W_max, where t is the time
+//! since the loss, so it regrows quickly towards the window where the loss happened,
+//! probes cautiously around it, and then accelerates away. The window never grows
+//! more slowly than an equivalent Reno flow would (the "Reno-friendly" region).
+class Cubic : public CongestionControl {
+  private:
+    static constexpr double C = 0.4;     //!< scaling constant, in segments per second cubed
+    static constexpr double BETA = 0.7;  //!< multiplicative decrease factor
+
+    // windows are kept in segments, as in the RFC
+    double _cwnd;
+    double _ssthresh;
+    double _w_max{0};           //!< window just before the last reduction
+    double _w_est{0};           //!< window a Reno flow would have reached in this epoch
+    double _k{0};               //!< seconds from the start of the epoch until W(t) returns to _w_max
+    double _origin{0};          //!< plateau of the cubic curve for this epoch
+    uint64_t _epoch_start{0};   //!< time the current growth epoch began
+    bool _in_epoch{false};      //!< whether _epoch_start is valid
+    uint64_t _min_rtt{0};       //!< smallest RTT sample seen, in milliseconds (0 if none)
+
+    void reduce();
+
+  public:
+    explicit Cubic(const size_t mss);
+
+    void set_mss(const size_t mss) override;
+    void on_ack(const size_t acked_bytes, const uint64_t now_ms) override;
+    void on_rtt_sample(const uint64_t rtt_ms) override;
+    void on_congestion_event(const size_t bytes_in_flight, const uint64_t now_ms) override;
+    void on_timeout(const size_t bytes_in_flight) override;
+    size_t cwnd() const override;
+    size_t ssthresh() const override;
+};
+
+#endif  // SPONGE_LIBSPONGE_CONGESTION_CONTROL_HH
@@ -51,7 +51,9 @@ void NetworkInterface::send_datagram(const InternetDatagram &dgram, const Addres
             push_datagram(ETHERNET_BROADCAST, EthernetHeader::TYPE_ARP, arp_request.serialize());
 
             // 还没有在 arp_wait_ipdata 队列中出现 ip 地址
-            _arp_request_time.emplace(next_hop_ip, 0);
+            const uint64_t expiry = _timers.now() + ARP_REPLY_TTL_MS;
+            _arp_request_time.emplace(next_hop_ip, expiry);
+            _timers.schedule(expiry, {next_hop_ip, true});
             _arp_wait_ipdata.insert({next_hop_ip, {dgram}});
         }
         // 在一定时间内已经发送过查询报文
@@ -87,7 +89,14 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
             return nullopt;
         }
         // ARP 报文即可更新 ARP cache table
-        _arp_table[arp_data.sender_ip_address] = {arp_data.sender_ethernet_address, 0};
+        // 已有的表项只推迟过期时间, 它的定时器到期时会按新的时间重新登记
+        const uint64_t expiry = _timers.now() + ARP_ENTRY_TTL_MS;
+        const bool learned =
+            _arp_table.insert_or_assign(arp_data.sender_ip_address, make_pair(arp_data.sender_ethernet_address, expiry))
+                .second;
+        if (learned) {
+            _timers.schedule(expiry, {arp_data.sender_ip_address, false});
+        }
 
         // ARP request 报文, 需要发送 ARP reply报文
         if (arp_data.opcode == ARPMessage::OPCODE_REQUEST && arp_data.target_ip_address == _ip_address.ipv4_numeric()) {
@@ -116,26 +125,30 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void NetworkInterface::tick(const size_t ms_since_last_tick) {
     // tick time pass
-    // delete arp cache table which deactive
-    for (auto it = _arp_table.begin(); it != _arp_table.end();) {
-        it->second.second += ms_since_last_tick;
-        if (ARP_ENTRY_TTL_MS <= it->second.second) {
-            it = _arp_table.erase(it);
-        } else {
-            it++;
+    // 只处理到期的定时器: 过期的 ARP 表项, 以及超时的 ARP 请求和等待它的 ip_data
+    _timers.advance(_timers.now() + ms_since_last_tick,
+                    [&](const uint64_t expiry, const ARPTimer &timer) { timer_expired(expiry, timer); });
+}
+
+void NetworkInterface::timer_expired(const uint64_t expiry, const ARPTimer &timer) {
+    if (timer.request) {
+        // 请求超时, 删除请求记录以及对应的 ip_data, 之后可以重新查询
+        const auto it = _arp_request_time.find(timer.ip);
+        if (it != _arp_request_time.end() && it->second <= expiry) {
+            _arp_request_time.erase(it);
+            _arp_wait_ipdata.erase(timer.ip);
         }
+        return;
     }
-    // delete arp_request_time 删除其中 request 超时的部分, 同时删除对应的 ip_data
-    for (auto it = _arp_request_time.begin(); it != _arp_request_time.end();) {
-        it->second += ms_since_last_tick;
-        if (ARP_REPLY_TTL_MS <= it->second) {
-            if (_arp_wait_ipdata.find(it->first) != _arp_wait_ipdata.end()) {
-                _arp_wait_ipdata.erase(it->first);
-            }
-            it = _arp_request_time.erase(it);
-        } else {
-            it++;
-        }
+    const auto it = _arp_table.find(timer.ip);
+    if (it == _arp_table.end()) {
+        return;
+    }
+    // 表项在定时器登记之后又被刷新过, 按新的过期时间重新登记
+    if (it->second.second > expiry) {
+        _timers.schedule(it->second.second, timer);
+    } else {
+        _arp_table.erase(it);
     }
 }
 
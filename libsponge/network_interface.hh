@@ -3,6 +3,7 @@
 
 #include "ethernet_frame.hh"
 #include "tcp_over_ip.hh"
+#include "timer_wheel.hh"
 #include "tun.hh"
 
 #include <optional>
@@ -48,12 +49,23 @@ class NetworkInterface {
     // support datastruct
 
     // ARP Cache 表
-    // IP address EthernetAddress TTL
-    std::unordered_map<uint32_t, std::pair<EthernetAddress, size_t>> _arp_table{};
+    // IP address EthernetAddress 过期时间
+    std::unordered_map<uint32_t, std::pair<EthernetAddress, uint64_t>> _arp_table{};
 
     // 正在查询的 ARP 报文
-    // IP address time
-    std::unordered_map<uint32_t, size_t> _arp_request_time{};
+    // IP address 请求超时的时间
+    std::unordered_map<uint32_t, uint64_t> _arp_request_time{};
+
+    // ARP 表项过期和 ARP 请求超时都登记在时间轮上, tick 只处理到期的那些, 不再遍历两张表
+    // 定时器的内容: IP 地址, 以及是 ARP 请求超时还是表项过期
+    struct ARPTimer {
+        uint32_t ip;
+        bool request;
+    };
+    TimerWheel<ARPTimer> _timers{};
+
+    // 时间轮上的定时器到期: 删除过期的 ARP 表项或超时的 ARP 请求
+    void timer_expired(const uint64_t expiry, const ARPTimer &timer);
 
     // 存储 发送的 MAC 地址未被确认的IP报文
     std::unordered_map<uint32_t, std::vector<InternetDatagram>> _arp_wait_ipdata{};
@@ -1,5 +1,7 @@
 #include "stream_reassembler.hh"
 
+#include <cstring>
+
 // Dummy implementation of a stream reassembler.
 
 // For Lab 1, please replace with a real implementation that passes the
@@ -15,123 +17,202 @@ using namespace std;
 StreamReassembler::StreamReassembler(const size_t capacity)
     : _output(capacity)
     , _capacity(capacity)
-    , _unassembled_bytes()
+    , _window()
     , _unassembled_cnt(0)
-    , _unassembled_index(0)
-    , _unaccepted_index(0)
     , _eof_index(numeric_limits<size_t>::max()) {}
 
 //! \details This function accepts a substring (aka a segment) of bytes,
 //! possibly out-of-order, from the logical stream, and assembles any newly
 //! contiguous substrings and writes them into the output stream in order.
 void StreamReassembler::push_substring(const string &data, const size_t index, const bool eof) {
-    // 如果该字段包含 eof, 则将 _eof_index 置到正确的位置上
-    if (eof) {
-        _eof_index = index + data.size();
-    }
+    push_substring(string_view(data), index, eof);
+}
 
-    // 如果当前 eof 已经被读入到 output_buffer 中退出 push
-    if (_unassembled_index >= _eof_index) {
-        _output.end_input();
+//! \details The core of push_substring; the other overloads forward here,
+//! so a payload parsed out of a datagram is never copied into an intermediate std::string.
+void StreamReassembler::push_substring(string_view data, const size_t index, const bool eof) {
+    // 流已经结束, 之后的数据都是多余的 (writable_spans 写入不经过 ByteStream::write 的检查)
+    if (_output.input_ended()) {
         return;
     }
 
-    // data 整体在 _unassembled_index 之前
-    // data 整体在 _unaccepted_index 之后
-    _unaccepted_index = _output.bytes_read() + _capacity;
-    if (index + data.size() < _unassembled_index || index > _unaccepted_index) {
-        return;
+    // 如果该字段包含 eof, 则将 _eof_index 置到正确的位置上, 并丢弃已保存的 eof 之后的字节
+    if (eof) {
+        _eof_index = index + data.size();
+        trim_to_eof();
     }
 
-    // index > _unassembled_index
-    if (index > _unassembled_index) {
-        merge_string(const_cast<std::string &>(data), index);
-    } else {
-        // index <= _unassembled_index 的做左右两次切割
-        // 左侧切割 _unassembled 部分, 右侧切割 _unaccept 部分以及做好容量控制
-        size_t bound_index = min(index + data.size(), _unaccepted_index);
-        string write_data =
-            data.substr(_unassembled_index - index,
-                        min(bound_index - _unassembled_index, _capacity - _output.buffer_size() - unassembled_bytes()));
-        size_t written_size = _output.write(write_data);
-        _unassembled_index += written_size;
-
-        // output write 之后检查 map 中是否有可以写入的部分了
-        // 非 unordered_map 默认按照键的大小升序排列检查 map_index <= _unassembled_index 即可
-        while (!_unassembled_bytes.empty()) {
-            auto &[map_index, map_str] = *_unassembled_bytes.begin();
-            if (map_index <= _unassembled_index) {
-                if (map_index + map_str.size() > _unassembled_index) {
-                    written_size = _output.write(map_str.substr(_unassembled_index - map_index));
-                    _unassembled_index += written_size;
-                }
-                _unassembled_cnt -= (*_unassembled_bytes.begin()).second.size();
-                _unassembled_bytes.erase(_unassembled_bytes.begin());
-            } else {
-                break;
+    // 可以接收的窗口 [first_unassembled, first_unacceptable), 不超过 eof
+    const uint64_t first_unassembled = _output.bytes_written();
+    const uint64_t first_unacceptable =
+        max(first_unassembled, min(_output.bytes_read() + _capacity, uint64_t{_eof_index}));
+
+    // 快速路径: 按序到达且没有待组装的区间, 直接写入 output, 不需要查 map
+    if (index == first_unassembled && _unassembled_intervals.empty()) {
+        _fast_path_cnt++;
+        write_output(data.substr(0, first_unacceptable - first_unassembled));
+        if (_output.bytes_written() >= _eof_index) {
+            _output.end_input();
+        }
+        return;
+    }
+    _slow_path_cnt++;
+
+    // 左右两次切割, 只保留落在窗口内的部分
+    const uint64_t start = max(index, first_unassembled);
+    const uint64_t end = min(index + data.size(), first_unacceptable);
+    if (start < end) {
+        if (start == first_unassembled) {
+            // 紧接着已组装的部分, 直接写入 output, 再把窗口中接得上的区间一并写入
+            write_output(data.substr(start - index, end - start));
+            uint64_t assembled_end = end;
+            auto iter = _unassembled_intervals.begin();
+            while (iter != _unassembled_intervals.end() && iter->first <= end) {
+                assembled_end = max(assembled_end, iter->second);
+                _unassembled_cnt -= iter->second - iter->first;
+                iter = _unassembled_intervals.erase(iter);
+            }
+            if (assembled_end > end) {
+                assemble(assembled_end);
             }
+        } else if (!_shed_out_of_order) {
+            store(data.substr(start - index, end - start), start);
+            insert_interval(start, end);
         }
     }
+
     // eof 字段被组装, 结束
-    if (_unassembled_index >= _eof_index) {
+    if (_output.bytes_written() >= _eof_index) {
         _output.end_input();
     }
 }
 
-void StreamReassembler::merge_string(string &data, uint64_t index) {
-    // 左闭右开区间
-    size_t st = index, ed = index + data.size();
+void StreamReassembler::trim_to_eof() {
+    auto iter = _unassembled_intervals.lower_bound(_eof_index);
+    while (iter != _unassembled_intervals.end()) {
+        _unassembled_cnt -= iter->second - iter->first;
+        iter = _unassembled_intervals.erase(iter);
+    }
+    if (!_unassembled_intervals.empty()) {
+        auto last = prev(_unassembled_intervals.end());
+        if (last->second > _eof_index) {
+            _unassembled_cnt -= last->second - _eof_index;
+            last->second = _eof_index;
+        }
+    }
+}
 
-    auto iter = _unassembled_bytes.begin();
+void StreamReassembler::write_output(string_view data) {
+    // 调用者保证 data 不超过 output 的剩余容量; 空的 payload (如 SYN) 不必为它分配环形缓冲区
+    if (data.empty()) {
+        return;
+    }
+    size_t copied = 0;
+    for (const auto &span : _output.writable_spans()) {
+        const size_t n = min(span.iov_len, data.size() - copied);
+        memcpy(span.iov_base, data.data() + copied, n);
+        copied += n;
+    }
+    _output.commit_write(copied);
+}
 
-    while (iter != _unassembled_bytes.end()) {
-        // 跳出循环
-        if (index + data.size() <= (*iter).first) {
-            break;
+void StreamReassembler::store(string_view data, const uint64_t index) {
+    if (_window.empty()) {
+        _window.resize(_capacity);
+        _window_charge.set(_window.size());
+    }
+    // 窗口是环形的, 最多分两段拷贝
+    const size_t offset = index % _capacity;
+    const size_t first = min(data.size(), _capacity - offset);
+    memcpy(_window.data() + offset, data.data(), first);
+    memcpy(_window.data(), data.data() + first, data.size() - first);
+}
+
+void StreamReassembler::insert_interval(uint64_t start, uint64_t end) {
+    // upper_bound 找到第一个起点在 start 之后的区间, 起点不超过 start 的区间只需要检查它前面的一个
+    auto iter = _unassembled_intervals.upper_bound(start);
+    if (iter != _unassembled_intervals.begin()) {
+        auto prev_iter = prev(iter);
+        if (prev_iter->second >= start) {
+            start = prev_iter->first;
+            end = max(end, prev_iter->second);
+            _unassembled_cnt -= prev_iter->second - prev_iter->first;
+            _unassembled_intervals.erase(prev_iter);
         }
-        const string &sub_str = (*iter).second;
-        size_t map_st = (*iter).first, map_ed = map_st + sub_str.size();
-        // 需要进行覆盖或者重叠操作
-        if (st < map_ed && map_st < ed) {
-            // 插入的部分 覆盖 map 的部分
-            if (st <= map_st && ed >= map_ed) {
-                _unassembled_cnt -= (*iter).second.size();
-                iter = _unassembled_bytes.erase(iter);
-            }
-            // map的部分 覆盖 插入的部分
-            else if (map_st <= st && map_ed >= ed) {
-                data.clear();
-                ++iter;
-            }
-            // 插入部分 与 map 中有交叉
-            else {
-                // data 在 map 元素之前
-                if (st <= map_st) {
-                    data += sub_str.substr(ed - map_st, map_ed - ed);
-                }
-                // data 在 map 元素之后
-                else {
-                    index = map_st;
-                    data.insert(0, sub_str.substr(0, st - map_st));
-                }
-                _unassembled_cnt -= (*iter).second.size();
-                iter = _unassembled_bytes.erase(iter);
+    }
+    // 吞并后面所有与 [start, end) 重叠或相邻的区间
+    while (iter != _unassembled_intervals.end() && iter->first <= end) {
+        end = max(end, iter->second);
+        _unassembled_cnt -= iter->second - iter->first;
+        iter = _unassembled_intervals.erase(iter);
+    }
+    _unassembled_intervals.emplace_hint(iter, start, end);
+    _unassembled_cnt += end - start;
+}
+
+void StreamReassembler::assemble(const uint64_t end) {
+    // 从窗口拷贝到 output 的环形缓冲区, 两边都可能绕回, 按较短的连续段逐段拷贝
+    uint64_t index = _output.bytes_written();
+    const auto spans = _output.writable_spans();
+    for (const auto &span : spans) {
+        size_t span_offset = 0;
+        while (span_offset < span.iov_len && index < end) {
+            const size_t offset = index % _capacity;
+            const size_t n = min({span.iov_len - span_offset, _capacity - offset, static_cast<size_t>(end - index)});
+            memcpy(static_cast<char *>(span.iov_base) + span_offset, _window.data() + offset, n);
+            span_offset += n;
+            index += n;
+        }
+    }
+    _output.commit_write(index - _output.bytes_written());
+}
+
+// 取模的位置随容量变化, 已保存的区间逐段搬到新窗口中的位置
+void StreamReassembler::grow_capacity(const size_t capacity) {
+    if (capacity <= _capacity) {
+        return;
+    }
+    _output.set_capacity(capacity);
+    if (not _window.empty()) {
+        vector<char> window(capacity);
+        for (const auto &[start, end] : _unassembled_intervals) {
+            for (uint64_t index = start; index < end;) {
+                const size_t from = index % _capacity, to = index % capacity;
+                const size_t n = min({_capacity - from, capacity - to, static_cast<size_t>(end - index)});
+                memcpy(window.data() + to, _window.data() + from, n);
+                index += n;
             }
-        } else {
-            ++iter;
         }
+        _window.swap(window);
+        _window_charge.set(_window.size());
+    }
+    _capacity = capacity;
+}
+
+void StreamReassembler::release_memory() {
+    if (_unassembled_intervals.empty()) {
+        vector<char>().swap(_window);
+        _window_charge.set(0);
     }
+    _output.release_memory();
+}
 
-    if (!data.empty()) {
-        // 实际插入需要进行容量检查, 两次容量检查确定读入多少字符
-        _unaccepted_index = _output.bytes_read() + _capacity;
-        size_t bound_index = min(index + data.size(), _unaccepted_index);
-        size_t insert_size = min(bound_index - index, _capacity - _output.buffer_size() - unassembled_bytes());
-        _unassembled_cnt += insert_size;
-        _unassembled_bytes.insert(make_pair(index, data.substr(0, insert_size)));
+void StreamReassembler::shed_out_of_order(const bool shed) {
+    _shed_out_of_order = shed;
+    if (shed) {
+        drop_unassembled();
     }
 }
 
+size_t StreamReassembler::drop_unassembled() {
+    const size_t dropped = _unassembled_cnt;
+    _unassembled_intervals.clear();
+    _unassembled_cnt = 0;
+    vector<char>().swap(_window);
+    _window_charge.set(0);
+    return dropped;
+}
+
 size_t StreamReassembler::unassembled_bytes() const { return _unassembled_cnt; }
 
-bool StreamReassembler::empty() const { return _unassembled_bytes.empty(); }
\ No newline at end of file
+bool StreamReassembler::empty() const { return _unassembled_intervals.empty(); }
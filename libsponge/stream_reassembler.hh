@@ -1,13 +1,17 @@
 #ifndef SPONGE_LIBSPONGE_STREAM_REASSEMBLER_HH
 #define SPONGE_LIBSPONGE_STREAM_REASSEMBLER_HH
 
+#include "buffer.hh"
 #include "byte_stream.hh"
+#include "memory_ledger.hh"
 
 #include <algorithm>
 #include <cstdint>
 #include <limits>
 #include <map>
 #include <string>
+#include <string_view>
+#include <vector>
 
 //! \brief A class that assembles a series of excerpts from a byte stream (possibly out of order,
 //! possibly overlapping) into an in-order byte stream.
@@ -17,13 +21,35 @@ class StreamReassembler {
 
     ByteStream _output;  //!< The reassembled in-order byte stream
     size_t _capacity;    //!< The maximum number of bytes
-    std::map<size_t, std::string> _unassembled_bytes;
+    // 预分配的窗口缓冲区, 字节 index 存放在 index % _capacity 处
+    // 窗口 [bytes_written, bytes_read + _capacity) 的长度不超过 _capacity, 所以不会冲突
+    // 第一次有乱序数据时才分配, 分配的内存计入 MemoryLedger
+    std::vector<char> _window;
+    MemoryCharge _window_charge{};
+    // 已保存但尚未组装的区间 [start, end), 以 start 为键, 区间之间互不重叠也不相邻
+    std::map<size_t, size_t> _unassembled_intervals{};
     size_t _unassembled_cnt;
-    size_t _unassembled_index;
-    size_t _unaccepted_index;
     size_t _eof_index;
+    // 统计走快速路径 (按序到达且没有待组装区间) 和慢速路径的次数
+    size_t _fast_path_cnt{0};
+    size_t _slow_path_cnt{0};
+    // 内存紧张时不保存乱序数据, 只接收按序到达的部分
+    bool _shed_out_of_order{false};
 
-    void merge_string(std::string &data, uint64_t index);
+    //! Forget the bytes held at or beyond _eof_index
+    void trim_to_eof();
+
+    //! Copy in-order `data` straight into the output stream's free space
+    void write_output(std::string_view data);
+
+    //! Copy `data` (which starts at stream index `index`) into the window
+    void store(std::string_view data, const uint64_t index);
+
+    //! Record [start, end) as held in the window, merging with neighboring intervals
+    void insert_interval(uint64_t start, uint64_t end);
+
+    //! Move the window bytes [bytes_written, end) into the output stream
+    void assemble(const uint64_t end);
 
   public:
     //! \brief Construct a `StreamReassembler` that will store up to `capacity` bytes.
@@ -41,6 +67,40 @@ class StreamReassembler {
     //! \param eof the last byte of `data` will be the last byte in the entire stream
     void push_substring(const std::string &data, const uint64_t index, const bool eof);
 
+    //! \brief Receive a substring held in a string_view (e.g. a slice of a received datagram)
+    //! \details Same as push_substring(const std::string &, ...), but without requiring a std::string.
+    //! The bytes are copied directly into the output stream (or the reassembly window).
+    void push_substring(std::string_view data, const uint64_t index, const bool eof);
+
+    //! \brief Receive a substring given as a C string literal
+    //! \details Without it, a literal would convert equally well to std::string and std::string_view.
+    void push_substring(const char *data, const uint64_t index, const bool eof) {
+        push_substring(std::string_view(data), index, eof);
+    }
+
+    //! \brief Receive a substring held in a Buffer (e.g. the payload of a parsed TCPSegment)
+    void push_substring(const Buffer &data, const uint64_t index, const bool eof) {
+        push_substring(data.str(), index, eof);
+    }
+
+    //! \brief Raise the capacity (of both the window and the output stream) to `capacity`; a smaller value is ignored
+    //! \details Bytes held out of order keep their stream indices, so the window can only widen.
+    void grow_capacity(const size_t capacity);
+
+    //! \brief Free the window and the output stream's ring while they hold nothing (see ByteStream::release_memory())
+    void release_memory();
+
+    //! \brief While `shed` is true, drop (and stop storing) bytes that arrive out of order, e.g. under memory
+    //! pressure: in-order bytes are still written to the stream, and the sender will send the rest again
+    void shed_out_of_order(const bool shed);
+
+    //! \brief Discard every byte held out of order, and free the window
+    //! \returns the number of bytes discarded
+    size_t drop_unassembled();
+
+    //! \returns the bytes of memory held by the window and the output stream
+    size_t memory_usage() const { return _window.size() + _output.memory_usage(); }
+
     //! \name Access the reassembled byte stream
     //!@{
     const ByteStream &stream_out() const { return _output; }
@@ -56,6 +116,19 @@ class StreamReassembler {
     //! \brief Is the internal state empty (other than the output stream)?
     //! \returns `true` if no substrings are waiting to be assembled
     bool empty() const;
+
+    //! \brief The disjoint, non-adjacent [start, end) index ranges stored but not yet reassembled, keyed by start
+    const std::map<size_t, size_t> &unassembled_intervals() const { return _unassembled_intervals; }
+
+    //! \name Fast-path accounting
+    //!@{
+
+    //! \brief Number of substrings that arrived in order with nothing pending, and went straight to the stream
+    size_t fast_path_pushes() const { return _fast_path_cnt; }
+
+    //! \brief Number of substrings that had to go through the window and interval map
+    size_t slow_path_pushes() const { return _slow_path_cnt; }
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_STREAM_REASSEMBLER_HH
@@ -1,6 +1,8 @@
 #include "tcp_connection.hh"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 // Dummy implementation of a TCP connection
 
@@ -21,15 +23,51 @@ size_t TCPConnection::unassembled_bytes() const { return _receiver.unassembled_b
 // time since last segment receive
 size_t TCPConnection::time_since_last_segment_received() const { return _time_since_last_segment_received; }
 
+size_t TCPConnection::buffer_memory_usage() const {
+    return _sender.memory_usage() + _receiver.memory_usage();
+}
+
+void TCPConnection::segment_received(const TCPSegment &seg) {
+    apply_memory_pressure();
+    receive_segment(seg);
+    autotune_buffers();
+    // 将 sender 和 receiver 组装好的 TCP 发送出去
+    segment_assemble_send();
+}
+
+// 一批 segment 逐个处理后只组装发送一次: 需要回复的 ACK 排在 sender 的队列里,
+// 后面的 segment 看到队列非空就不再另发 ACK, 最后统一带上最新的 ackno 和窗口
+// 只有按序的数据才能这样合并 ACK: 乱序或重复的 segment 每个都要有自己的 (重复) ACK,
+// 否则对端凑不齐三个重复 ACK, 无法快速重传; 所以先发出之前排队的回复, 处理完立即回复它
+void TCPConnection::segments_received(const vector<TCPSegment> &segments) {
+    apply_memory_pressure();
+    for (const auto &seg : segments) {
+        const optional<WrappingInt32> ackno = _receiver.ackno();
+        const bool in_order = ackno.has_value() && seg.header().seqno == ackno.value() &&
+                              _receiver.unassembled_bytes() == 0;
+        const bool ack_alone = seg.length_in_sequence_space() > 0 && !in_order;
+        if (ack_alone) {
+            segment_assemble_send();
+        }
+        receive_segment(seg);
+        if (ack_alone) {
+            segment_assemble_send();
+        }
+    }
+    autotune_buffers();
+    segment_assemble_send();
+}
+
 // 接收数据包
 // 收到 segment 分成两个部分 payload 交给 receiver
-// ackno 以及 window_size 交给
-void TCPConnection::segment_received(const TCPSegment &seg) {
+// ackno 以及 window_size 交给 sender, 要发送的 segment 留在 sender 的队列中, 由调用者组装发送
+void TCPConnection::receive_segment(const TCPSegment &seg) {
     if (!active()) {
         return;
     }
 
     _time_since_last_segment_received = 0;
+    _buffers_released = false;
 
     const TCPHeader &header = seg.header();
 
@@ -39,23 +77,45 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
         return;
     }
 
-    // receiver 处理 payload
-    _receiver.segment_received(seg);
+    // 对端的 SYN 通告了 MSS, 发送的 payload 不能超过它
+    if (header.syn && header.mss.has_value()) {
+        _sender.set_peer_mss(header.mss.value());
+    }
+    // 对端的 SYN 没有带 SACK-permitted 则不使用 SACK
+    // 窗口缩放也一样, 需要双方的 SYN 都带上选项
+    if (header.syn) {
+        _sender.set_peer_sack_permitted(header.sack_permitted);
+        _sender.set_peer_window_scale(header.wscale);
+        _sender.set_peer_timestamps(header.timestamps.has_value());
+        _receiver.set_timestamps(_sender.timestamps());
+    }
+
+    // receiver 处理 payload, 记下之前的状态用于判断能否延迟 ACK
+    const optional<WrappingInt32> ackno_before = _receiver.ackno();
+    const size_t unassembled_before = _receiver.unassembled_bytes();
+    if (!_receiver.segment_received(seg)) {
+        // 被 PAWS 拒绝的旧 segment 整个忽略, 只回复一个 ACK (RFC 7323 第 5.3 节)
+        _sender.send_empty_segment();
+        return;
+    }
 
     // 收到 ack 标识, sender 处理 ackno, window_size
     if (header.ack) {
-        _sender.ack_received(header.ackno, header.win);
+        // SYN 中的窗口不缩放 (RFC 7323 第 2.2 节)
+        const uint64_t window = header.syn ? header.win : uint64_t{header.win} << _sender.send_window_shift();
+        const optional<uint32_t> tsecr =
+            header.timestamps.has_value() ? optional<uint32_t>{header.timestamps->tsecr} : nullopt;
+        _sender.ack_received(header.ackno, window, seg.length_in_sequence_space() > 0, header.sack, tsecr);
     }
 
-    // 收到 SYN 标识, 建立 tcp 连接
+    // 收到 SYN 标识, 建立 tcp 连接 (发出 SYN-ACK)
     if (header.syn && _sender.next_seqno_absolute() == 0) {
-        connect();
+        _sender.fill_window();
         return;
     }
 
     // CLOSE_WAIT 表示满足 prerequest 1-3 置位
-    if (TCPState::state_summary(_receiver) == TCPReceiverStateSummary::FIN_RECV &&
-        TCPState::state_summary(_sender) == TCPSenderStateSummary::SYN_ACKED) {
+    if (_receiver.state() == TCPReceiverState::FIN_RECV && _sender.state() == TCPSenderState::SYN_ACKED) {
         _linger_after_streams_finish = false;
     }
 
@@ -66,21 +126,41 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
         _sender.send_empty_segment();
     }
 
-    // 如果收到的TCP segment 有占位空间, 则必须返回空的序列包
+    // 如果收到的TCP segment 有占位空间, 则必须返回空的序列包 (除非可以延迟 ACK)
     if (seg.length_in_sequence_space() > 0 && _sender.segments_out().empty()) {
         _sender.fill_window();
-        if (_sender.segments_out().empty()) {
+        if (_sender.segments_out().empty() && !can_delay_ack(seg, ackno_before, unassembled_before)) {
             _sender.send_empty_segment();
         }
     }
+}
 
-    // 将 sender 和 receiver 组装好的 TCP 发送出去
-    segment_assemble_send();
+// 只有按序到达, 且没有乱序数据 (之前和之后都没有空洞) 的普通数据才推迟 ACK
+// SYN, FIN, 重复或乱序的数据, 以及第二个满 MSS (协商后的 MSS) 的 segment 都立即确认 (RFC 5681 第 4.2 节)
+// 不满 MSS 的 segment 不计数, 由延迟 ACK 的定时器兜底; 接收合并得到的 segment 装了几个 MSS 就算几个
+bool TCPConnection::can_delay_ack(const TCPSegment &seg,
+                                  const optional<WrappingInt32> ackno_before,
+                                  const size_t unassembled_before) {
+    const TCPHeader &header = seg.header();
+    const bool in_order = ackno_before.has_value() && header.seqno == ackno_before.value() &&
+                          _receiver.ackno() == ackno_before.value() + seg.length_in_sequence_space();
+    const size_t full_sized = seg.payload_size() / _sender.max_payload_size();
+    if (_cfg.delayed_ack_timeout == 0 || header.syn || header.fin || !in_order || unassembled_before > 0 ||
+        _receiver.unassembled_bytes() > 0 || _delayed_ack_full_sized + full_sized >= 2) {
+        return false;
+    }
+    if (_delayed_ack_segments == 0) {
+        _delayed_ack_elapsed = 0;
+    }
+    _delayed_ack_segments++;
+    _delayed_ack_full_sized += full_sized;
+    return true;
 }
 
 bool TCPConnection::active() const { return _is_active; }
 
 size_t TCPConnection::write(const string &data) {
+    _buffers_released = false;
     size_t len = _sender.stream_in().write(data);
     // sender push 到自己的成员 segment_out 中
     _sender.fill_window();
@@ -89,12 +169,29 @@ size_t TCPConnection::write(const string &data) {
     return len;
 }
 
+size_t TCPConnection::write(Buffer data) {
+    _buffers_released = false;
+    size_t len = _sender.stream_in().write(std::move(data));
+    _sender.fill_window();
+    segment_assemble_send();
+    return len;
+}
+
 // time tick passing
 //! \param[in] ms_since_last_tick number of milliseconds since the last call to this method
 void TCPConnection::tick(const size_t ms_since_last_tick) {
     // tick
     _sender.tick(ms_since_last_tick);
     _time_since_last_segment_received += ms_since_last_tick;
+    _autotune_elapsed += ms_since_last_tick;
+
+    // 延迟 ACK 的定时器到期, 发送 ACK (如果没有数据段顺便捎带)
+    if (_delayed_ack_segments > 0) {
+        _delayed_ack_elapsed += ms_since_last_tick;
+        if (_delayed_ack_elapsed >= _cfg.delayed_ack_timeout && _sender.segments_out().empty()) {
+            _sender.send_empty_segment();
+        }
+    }
 
     // 情况一: 重传次数超过约定上限
     if (TCPConfig::MAX_RETX_ATTEMPTS < _sender.consecutive_retransmissions()) {
@@ -109,11 +206,12 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
     }
 
     // tick 时间内有新的 segment 需要发送
+    apply_memory_pressure();
+    autotune_buffers();
     segment_assemble_send();
 
     // 满足三个前置条件 prereq 1 & 2 & 3
-    if (TCPState::state_summary(_receiver) == TCPReceiverStateSummary::FIN_RECV &&
-        TCPState::state_summary(_sender) == TCPSenderStateSummary::FIN_ACKED) {
+    if (streams_finished()) {
         // 需要等待 默认为 true
         if (_linger_after_streams_finish) {
             if (_time_since_last_segment_received >= 10 * _cfg.rt_timeout) {
@@ -127,12 +225,95 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
     }
 }
 
+optional<uint64_t> TCPConnection::next_timeout() const {
+    if (!active()) {
+        return nullopt;
+    }
+    optional<uint64_t> timeout = _sender.next_timeout();
+    const auto at_most = [&](const uint64_t ms) { timeout = min(timeout.value_or(ms), ms); };
+    if (_delayed_ack_segments > 0) {
+        at_most(_delayed_ack_elapsed >= _cfg.delayed_ack_timeout ? 0 : _cfg.delayed_ack_timeout - _delayed_ack_elapsed);
+    }
+    // 空闲一个 RTO 后收缩缓冲区
+    if (_cfg.buffer_autotuning && can_release_buffers()) {
+        const uint64_t idle = _sender.retransmission_timeout();
+        at_most(_time_since_last_segment_received >= idle ? 0 : idle - _time_since_last_segment_received);
+    }
+    // 不需要 linger 时下一次 tick 就关闭
+    if (streams_finished()) {
+        const uint64_t linger = _linger_after_streams_finish ? 10 * _cfg.rt_timeout : 0;
+        at_most(_time_since_last_segment_received >= linger ? 0 : linger - _time_since_last_segment_received);
+    }
+    return timeout;
+}
+
+void TCPConnection::autotune_buffers() {
+    if (!_cfg.buffer_autotuning) {
+        return;
+    }
+    // 内存紧张时不再扩大, 空闲时照样收缩
+    const bool grow = MemoryLedger::global().pressure() == MemoryPressure::None;
+
+    // 发送缓冲区至少放得下两个发送窗口的数据, 这样应用在 ACK 回来之前就能把下一个窗口准备好
+    ByteStream &outbound = _sender.stream_in();
+    const uint64_t send_target = min(2 * _sender.send_window(), uint64_t{_cfg.send_capacity_max});
+    if (grow && send_target > outbound.capacity()) {
+        outbound.set_capacity(send_target);
+    }
+
+    // 接收缓冲区每个 SRTT 测量一次收到的字节数: 超过一半容量说明窗口限制了对端, 扩大到两倍 (每次最多翻倍)
+    // 不超过能用窗口字段通告的大小, 通告不了的容量只是浪费内存
+    const uint64_t received = _receiver.stream_out().bytes_written();
+    if (_autotune_elapsed >= max(_sender.smoothed_rtt(), uint64_t{1})) {
+        const uint64_t in_interval = received - _autotune_received;
+        const size_t capacity = _receiver.capacity();
+        const size_t advertisable = size_t{numeric_limits<uint16_t>::max()} << _sender.recv_window_shift();
+        if (grow && 2 * in_interval > capacity) {
+            _receiver.grow_capacity(min({size_t{2 * in_interval}, 2 * capacity, _cfg.recv_capacity_max, advertisable}));
+        }
+        _autotune_elapsed = 0;
+        _autotune_received = received;
+    }
+
+    // 空闲了一个 RTO: 发送缓冲区回到配置的大小, 接收缓冲区的内存先释放, 等数据再来时重新分配
+    // (接收容量不缩小, 否则已经通告的窗口右沿会后退)
+    if (can_release_buffers() && _time_since_last_segment_received >= _sender.retransmission_timeout()) {
+        if (outbound.capacity() > _cfg.send_capacity) {
+            outbound.set_capacity(_cfg.send_capacity);
+        }
+        _receiver.release_memory();
+        _buffers_released = true;
+    }
+}
+
+void TCPConnection::apply_memory_pressure() {
+    const MemoryPressure pressure = MemoryLedger::global().pressure();
+    // 超过软限制窗口右沿不再前移; 超过硬限制再丢弃乱序数据, 对端还会重传, 而组装好的数据只能等应用读走
+    _receiver.hold_window(pressure != MemoryPressure::None);
+    _receiver.shed_out_of_order(pressure == MemoryPressure::Critical);
+}
+
+bool TCPConnection::can_release_buffers() const {
+    return !_buffers_released && _sender.stream_in().buffer_empty() && _sender.bytes_in_flight() == 0 &&
+           _receiver.stream_out().buffer_empty() && _receiver.unassembled_bytes() == 0;
+}
+
+bool TCPConnection::streams_finished() const {
+    return _receiver.state() == TCPReceiverState::FIN_RECV && _sender.state() == TCPSenderState::FIN_ACKED;
+}
+
 void TCPConnection::end_input_stream() {
     _sender.stream_in().end_input();
     _sender.fill_window();
     segment_assemble_send();
 }
 
+void TCPConnection::uncork() {
+    _sender.uncork();
+    _sender.fill_window();
+    segment_assemble_send();
+}
+
 void TCPConnection::connect() {
     _sender.fill_window();
     segment_assemble_send();
@@ -154,19 +335,52 @@ TCPConnection::~TCPConnection() {
 
 // 发送数据包
 void TCPConnection::segment_assemble_send() {
-    TCPSegment segment;
-    // sender part
-    while (!_sender.segments_out().empty()) {
-        segment = _sender.segments_out().front();
-        _sender.segments_out().pop();
-
-        // receiver part
-        if (_receiver.ackno().has_value()) {
-            segment.header().ack = true;
-            segment.header().ackno = _receiver.ackno().value();
+    queue<TCPSegment> &pending = _sender.segments_out();
+    if (pending.empty()) {
+        return;
+    }
+
+    // receiver part: 这次发出的 segment 带的 ACK 信息都一样 (ACK stamp), 只计算一次
+    // ackno, 窗口, 时间戳 (在 SYN 中提供, 协商后每个 segment 都带: 发送方的时钟, 以及回显对端的 TS.Recent)
+    const optional<WrappingInt32> ackno = _receiver.ackno();
+    if (ackno.has_value()) {
+        _receiver.ack_sent(ackno.value());
+        // 任何带 ACK 的 segment 都确认了之前推迟的数据
+        _delayed_ack_segments = 0;
+        _delayed_ack_full_sized = 0;
+    }
+    const uint16_t win = _receiver.window_advertisement(_sender.recv_window_shift());
+    TCPHeader stamp;
+    if (_sender.timestamps()) {
+        stamp.timestamps = TCPTimestamps{_sender.timestamp_clock(), ackno.has_value() ? _receiver.ts_recent() : 0};
+    }
+    // 双方协商了 SACK, 用剩余的选项空间报告乱序收到的区间 (SYN 的选项更多, 放得下的 block 可能更少)
+    vector<SACKBlock> sack;
+    if (_sender.sack_permitted()) {
+        const size_t free_space = TCPHeader::MAX_OPTIONS_LENGTH - stamp.options_length();
+        sack = _receiver.sack_blocks(free_space >= 4 ? (free_space - 4) / 8 : 0);
+    }
+
+    // sender part: segment 移出发送方的队列, 不再拷贝
+    while (!pending.empty()) {
+        TCPSegment &segment = pending.front();
+        TCPHeader &header = segment.header();
+        if (ackno.has_value()) {
+            header.ack = true;
+            header.ackno = ackno.value();
+        }
+        header.win = header.syn ? _receiver.window_advertisement(0) : win;
+        if (stamp.timestamps.has_value()) {
+            header.timestamps = stamp.timestamps;
+        }
+        if (!sack.empty()) {
+            const size_t free_space = TCPHeader::MAX_OPTIONS_LENGTH - header.options_length();
+            const size_t blocks = min(sack.size(), free_space >= 4 ? (free_space - 4) / 8 : 0);
+            header.sack.assign(sack.begin(), sack.begin() + blocks);
         }
-        segment.header().win = min(static_cast<size_t>(numeric_limits<uint16_t>::max()), _receiver.window_size());
-        _segments_out.emplace(std::move(segment));
+        header.doff = (TCPHeader::LENGTH + header.options_length()) / 4;
+        _segments_out.push(std::move(segment));
+        pending.pop();
     }
 }
 
@@ -11,7 +11,7 @@ class TCPConnection {
   private:
     TCPConfig _cfg;
     TCPReceiver _receiver{_cfg.recv_capacity};
-    TCPSender _sender{_cfg.send_capacity, _cfg.rt_timeout, _cfg.fixed_isn};
+    TCPSender _sender{_cfg};
 
     //! outbound queue of segments that the TCPConnection wants sent
     std::queue<TCPSegment> _segments_out{};
@@ -27,6 +27,17 @@ class TCPConnection {
 
     bool _is_active{true};
 
+    // 延迟 ACK: 尚未确认的 segment 数, 其中满 MSS 的 segment 数, 以及第一个未确认的 segment 到达后经过的时间
+    size_t _delayed_ack_segments{0};
+    size_t _delayed_ack_full_sized{0};
+    size_t _delayed_ack_elapsed{0};
+
+    // 缓冲区自动调整: 当前测量周期 (一个 SRTT) 已经过的时间, 周期开始时收到的字节数,
+    // 以及空闲后是否已经释放了缓冲区 (有新的活动之前不再检查)
+    size_t _autotune_elapsed{0};
+    uint64_t _autotune_received{0};
+    bool _buffers_released{false};
+
   public:
     //! \name "Input" interface for the writer
     //!@{
@@ -38,11 +49,21 @@ class TCPConnection {
     //! \returns the number of bytes from `data` that were actually written.
     size_t write(const std::string &data);
 
+    //! \brief Write a Buffer to the outbound byte stream without copying it, and send it over TCP if possible
+    //! \returns the number of bytes from `data` that were actually written.
+    size_t write(Buffer data);
+
     //! \returns the number of `bytes` that can be written right now.
     size_t remaining_outbound_capacity() const;
 
     //! \brief Shut down the outbound byte stream (still allows reading incoming data)
     void end_input_stream();
+
+    //! \brief Batch small writes: hold back segments smaller than the MSS until uncork() (like TCP_CORK)
+    void cork() { _sender.cork(); }
+
+    //! \brief Send the data held back since cork() right away
+    void uncork();
     //!@}
 
     //! \name "Output" interface for the reader
@@ -50,6 +71,7 @@ class TCPConnection {
 
     //! \brief The inbound byte stream received from the peer
     ByteStream &inbound_stream() { return _receiver.stream_out(); }
+    const ByteStream &inbound_stream() const { return _receiver.stream_out(); }
     //!@}
 
     //! \name Accessors used for testing
@@ -61,8 +83,31 @@ class TCPConnection {
     size_t unassembled_bytes() const;
     //! \brief Number of milliseconds since the last segment was received
     size_t time_since_last_segment_received() const;
+    //! \brief Smoothed round-trip time in milliseconds, or 0 before the first measurement
+    uint64_t smoothed_rtt() const { return _sender.smoothed_rtt(); }
+    //! \brief Current retransmission timeout in milliseconds, including any exponential backoff
+    uint64_t retransmission_timeout() const { return _sender.retransmission_timeout(); }
+    //! \brief Number of losses repaired by fast retransmit
+    uint64_t fast_retransmits() const { return _sender.fast_retransmits(); }
+    //! \brief Milliseconds until pacing lets more data go, if data is waiting only for pacing
+    std::optional<uint64_t> pacing_delay() const { return _sender.pacing_delay(); }
+    //! \brief Milliseconds until tick() next has something to do, or empty if no timer is running
+    //! \details Covers the retransmission timer, pacing, the delayed ACK and lingering after both streams
+    //! have finished, so an owner can leave the connection alone until then (ticking it later by all the
+    //! time that passed) instead of ticking it at a fixed interval.
+    std::optional<uint64_t> next_timeout() const;
+    //! \brief Bytes the outbound stream has room for (see TCPConfig::buffer_autotuning)
+    size_t send_capacity() const { return _sender.stream_in().capacity(); }
+    //! \brief Bytes the receiver will store at once (see TCPConfig::buffer_autotuning)
+    size_t receive_capacity() const { return _receiver.capacity(); }
+    //! \brief Bytes of memory held by the send and receive buffers (what they charge to MemoryLedger::global())
+    size_t buffer_memory_usage() const;
     //!< \brief summarize the state of the sender, receiver, and the connection
     TCPState state() const { return {_sender, _receiver, active(), _linger_after_streams_finish}; };
+    //! \brief State of the outbound stream (unlike state(), cheap enough for every segment)
+    TCPSenderState sender_state() const { return _sender.state(); }
+    //! \brief State of the inbound stream (unlike state(), cheap enough for every segment)
+    TCPReceiverState receiver_state() const { return _receiver.state(); }
     //!@}
 
     //! \name Methods for the owner or operating system to call
@@ -71,6 +116,13 @@ class TCPConnection {
     //! Called when a new segment has been received from the network
     void segment_received(const TCPSegment &seg);
 
+    //! \brief Called with several segments received from the network at once (e.g. every datagram that was ready)
+    //! \details Same as calling segment_received() on each in turn, except that the reply is assembled once,
+    //! after the last one: a single ACK for the in-order data of the whole batch, with the ackno and window as
+    //! of its end. A segment that is out of order or a duplicate is still answered with an ACK of its own, so
+    //! that the peer sees every duplicate ACK it needs for fast retransmit.
+    void segments_received(const std::vector<TCPSegment> &segments);
+
     //! Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 
@@ -102,9 +154,30 @@ class TCPConnection {
     //!@}
 
     // 自定义的成员函数
+    // 处理收到的一个 segment, 不组装发送 (segment_received 和 segments_received 共用)
+    void receive_segment(const TCPSegment &seg);
+
     // sender 和 receiver 填充 TCP segment 并发送到 segment_out
     void segment_assemble_send();
 
+    // 收到占用序号空间的 segment 后是否可以推迟 ACK
+    // 参数为处理该 segment 之前的 ackno 和未组装的字节数
+    bool can_delay_ack(const TCPSegment &seg,
+                       const std::optional<WrappingInt32> ackno_before,
+                       const size_t unassembled_before);
+
+    // 缓冲区自动调整 (TCPConfig::buffer_autotuning): 按发送窗口和每个 RTT 收到的数据扩大缓冲区, 空闲后收缩
+    void autotune_buffers();
+
+    // 按 MemoryLedger::global() 的压力调整接收: 超过软限制冻结窗口右沿, 超过硬限制丢弃乱序数据
+    void apply_memory_pressure();
+
+    // 缓冲区里没有数据, 也没有在途的数据, 空闲够久就可以收缩 (还没收缩过)
+    bool can_release_buffers() const;
+
+    // 两个方向的流都已结束 (收到了 FIN, 发出的 FIN 也被确认), 之后只剩等待 (linger) 和关闭
+    bool streams_finished() const;
+
     // 处理 clean shutdown 以及 unclean shutdown
     // clean shutdown 置 active = false
     // unclean shutdown 置 inbound outbound 为 error 以及以上 active
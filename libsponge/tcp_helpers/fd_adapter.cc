@@ -3,6 +3,7 @@
 #include <iostream>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
 using namespace std;
 
@@ -46,11 +47,51 @@ optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
 }
 
 //! Serialize a TCP segment and send it as the payload of a UDP datagram.
+//! A GSO super-segment is split into wire-sized segments, which all go out with one sendmmsg() call.
 //! \param[in] seg is the TCP segment to write
 void TCPOverUDPSocketAdapter::write(TCPSegment &seg) {
     seg.header().sport = config().source.port();
     seg.header().dport = config().destination.port();
-    _sock.sendto(config().destination, seg.serialize(0));
+    send(config().destination, seg);
+}
+
+//! \details Unlike read(), this does no filtering: the segment may belong to any connection, or to none yet.
+//! Over UDP, the UDP addresses and ports are the connection's: the local end of the FourTuple is the
+//! configured source address, and the remote end is the address the datagram came from.
+optional<pair<FourTuple, TCPSegment>> TCPOverUDPSocketAdapter::read_flow() {
+    auto datagram = _sock.recv();
+
+    TCPSegment seg;
+    if (ParseResult::NoError != seg.parse(move(datagram.payload), 0)) {
+        return {};
+    }
+
+    const FourTuple flow{config().source.ipv4_numeric(),
+                         config().source.ipv4_port(),
+                         datagram.source_address.ipv4_numeric(),
+                         datagram.source_address.ipv4_port()};
+    return make_pair(flow, move(seg));
+}
+
+//! \param[in] flow is the connection the segment belongs to
+//! \param[in] seg is the TCP segment to write
+void TCPOverUDPSocketAdapter::write_flow(const FourTuple &flow, TCPSegment &seg) {
+    seg.header().sport = flow.local_port;
+    seg.header().dport = flow.remote_port;
+    send(Address::from_ipv4_numeric(flow.remote_address, flow.remote_port), seg);
+}
+
+void TCPOverUDPSocketAdapter::send(const Address &destination, const TCPSegment &seg) {
+    if (seg.gso_size() == 0) {
+        _sock.sendto(destination, seg.serialize(0));
+        return;
+    }
+
+    vector<BufferList> datagrams;
+    for (const auto &piece : seg.gso_split()) {
+        datagrams.push_back(piece.serialize(0));
+    }
+    _sock.sendto(destination, vector<BufferViewList>(datagrams.begin(), datagrams.end()));
 }
 
 //! Specialize LossyFdAdapter to TCPOverUDPSocketAdapter
@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_FD_ADAPTER_HH
 
 #include "file_descriptor.hh"
+#include "flow_table.hh"
 #include "lossy_fd_adapter.hh"
 #include "socket.hh"
 #include "tcp_config.hh"
@@ -47,6 +48,9 @@ class TCPOverUDPSocketAdapter : public FdAdapterBase {
   private:
     UDPSocket _sock;
 
+    //! Sends a TCP segment (or the pieces of a GSO super-segment) to `destination`
+    void send(const Address &destination, const TCPSegment &seg);
+
   public:
     //! Construct from a UDPSocket sliced into a FileDescriptor
     explicit TCPOverUDPSocketAdapter(UDPSocket &&sock) : _sock(std::move(sock)) {}
@@ -54,9 +58,16 @@ class TCPOverUDPSocketAdapter : public FdAdapterBase {
     //! Attempts to read and return a TCP segment related to the current connection from a UDP payload
     std::optional<TCPSegment> read();
 
-    //! Writes a TCP segment into a UDP payload
+    //! Writes a TCP segment into a UDP payload, or a GSO super-segment into several
     void write(TCPSegment &seg);
 
+    //! \brief Reads a TCP segment from a UDP payload, whichever connection it belongs to (for TCPDemux)
+    //! \returns the segment and its connection, whose remote end is the datagram's source
+    std::optional<std::pair<FourTuple, TCPSegment>> read_flow();
+
+    //! \brief Writes a TCP segment of connection `flow` to the connection's remote end (for TCPDemux)
+    void write_flow(const FourTuple &flow, TCPSegment &seg);
+
     //! Access the underlying UDP socket
     operator UDPSocket &() { return _sock; }
 
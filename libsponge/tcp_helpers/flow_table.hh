@@ -0,0 +1,141 @@
+#ifndef SPONGE_LIBSPONGE_FLOW_TABLE_HH
+#define SPONGE_LIBSPONGE_FLOW_TABLE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! \brief The addresses and ports that identify one TCP connection, from the local end's point of view
+struct FourTuple {
+    uint32_t local_address = 0;   //!< local IPv4 address (host byte order)
+    uint16_t local_port = 0;      //!< local port
+    uint32_t remote_address = 0;  //!< remote IPv4 address (host byte order)
+    uint16_t remote_port = 0;     //!< remote port
+
+    //! \returns the same connection seen from the other end
+    FourTuple reversed() const { return {remote_address, remote_port, local_address, local_port}; }
+
+    //! \returns a 64-bit hash of the four fields
+    uint64_t hash() const {
+        // multiply-xorshift mixing of the two addresses and the two ports
+        uint64_t h = (uint64_t{local_address} << 32 | remote_address) * 0x9e3779b97f4a7c15;
+        h ^= (uint64_t{local_port} << 16 | remote_port) + (h >> 29);
+        return h * 0xbf58476d1ce4e5b9;
+    }
+
+    //! \returns e.g. "10.0.0.1:80 <-> 10.0.0.2:51234"
+    std::string to_string() const;
+
+    bool operator==(const FourTuple &other) const {
+        return local_address == other.local_address and local_port == other.local_port and
+               remote_address == other.remote_address and remote_port == other.remote_port;
+    }
+    bool operator!=(const FourTuple &other) const { return not operator==(other); }
+};
+
+//! \brief A hash table from FourTuple to `ValueT`, using open addressing with linear probing
+//! \details The slots live in one array, so a lookup is a hash, usually one slot comparison, and no
+//! pointer chasing. The table doubles when half full, and deletion shifts later entries of the probe
+//! sequence back rather than leaving tombstones, so lookups never slow down as connections come and go.
+//! Pointers to values stay valid until the next insert() or erase().
+template <typename ValueT>
+class FlowTable {
+  private:
+    struct Slot {
+        FourTuple key{};
+        ValueT value{};
+        bool used = false;
+    };
+
+    std::vector<Slot> _slots = std::vector<Slot>(16);
+    size_t _size = 0;
+
+    size_t mask() const { return _slots.size() - 1; }
+    size_t home(const FourTuple &key) const { return (key.hash() >> 32) & mask(); }
+
+    //! \returns the slot holding `key`, or the empty slot where it would go
+    size_t probe(const FourTuple &key) const {
+        size_t i = home(key);
+        while (_slots[i].used and _slots[i].key != key) {
+            i = (i + 1) & mask();
+        }
+        return i;
+    }
+
+    void grow() {
+        std::vector<Slot> old = std::exchange(_slots, std::vector<Slot>(2 * _slots.size()));
+        for (auto &slot : old) {
+            if (slot.used) {
+                _slots[probe(slot.key)] = std::move(slot);
+            }
+        }
+    }
+
+  public:
+    //! \returns the value stored for `key`, or nullptr
+    ValueT *find(const FourTuple &key) {
+        Slot &slot = _slots[probe(key)];
+        return slot.used ? &slot.value : nullptr;
+    }
+
+    //! \returns the value stored for `key`, or nullptr
+    const ValueT *find(const FourTuple &key) const {
+        const Slot &slot = _slots[probe(key)];
+        return slot.used ? &slot.value : nullptr;
+    }
+
+    //! \brief Store `value` for `key`, replacing any value already there
+    //! \returns the stored value
+    ValueT &insert(const FourTuple &key, ValueT value) {
+        if (2 * (_size + 1) > _slots.size()) {
+            grow();
+        }
+        Slot &slot = _slots[probe(key)];
+        if (not slot.used) {
+            slot.key = key;
+            slot.used = true;
+            _size++;
+        }
+        slot.value = std::move(value);
+        return slot.value;
+    }
+
+    //! \brief Remove `key` and its value
+    //! \returns whether `key` was present
+    bool erase(const FourTuple &key) {
+        size_t hole = probe(key);
+        if (not _slots[hole].used) {
+            return false;
+        }
+        // backward-shift deletion: move each later entry of the probe run into the hole if the hole lies
+        // between its home slot and its current slot, so that every remaining key stays reachable
+        for (size_t i = (hole + 1) & mask(); _slots[i].used; i = (i + 1) & mask()) {
+            const size_t distance_from_home = (i - home(_slots[i].key)) & mask();
+            const size_t distance_from_hole = (i - hole) & mask();
+            if (distance_from_home >= distance_from_hole) {
+                _slots[hole] = std::move(_slots[i]);
+                hole = i;
+            }
+        }
+        _slots[hole] = Slot{};
+        _size--;
+        return true;
+    }
+
+    //! \brief Call `f(key, value)` for every entry (which must not insert or erase entries)
+    template <typename F>
+    void for_each(F &&f) {
+        for (auto &slot : _slots) {
+            if (slot.used) {
+                f(static_cast<const FourTuple &>(slot.key), slot.value);
+            }
+        }
+    }
+
+    //! \returns the number of entries
+    size_t size() const { return _size; }
+};
+
+#endif  // SPONGE_LIBSPONGE_FLOW_TABLE_HH
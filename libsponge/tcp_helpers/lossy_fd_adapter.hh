@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_LOSSY_FD_ADAPTER_HH
 
 #include "file_descriptor.hh"
+#include "flow_table.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 #include "util.hh"
@@ -33,6 +34,9 @@ class LossyFdAdapter {
     //! Conversion to a FileDescriptor by returning the underlying AdapterT
     operator const FileDescriptor &() const { return _adapter; }
 
+    //! Conversion to a mutable FileDescriptor (e.g. to make it non-blocking)
+    operator FileDescriptor &() { return _adapter; }
+
     //! Construct from a FileDescriptor appropriate to the AdapterT constructor
     explicit LossyFdAdapter(AdapterT &&adapter) : _adapter(std::move(adapter)) {}
 
@@ -49,13 +53,44 @@ class LossyFdAdapter {
 
     //! \brief Write to the underlying AdapterT instance, potentially dropping the datagram to be written
     //! \param[in] seg is the packet to either write or drop
+    //! \note Each piece of a GSO super-segment is dropped independently, as on the wire
     void write(TCPSegment &seg) {
+        if (seg.gso_size() > 0 and _adapter.config().loss_rate_up != 0) {
+            for (auto &piece : seg.gso_split()) {
+                write(piece);
+            }
+            return;
+        }
         if (_should_drop(true)) {
             return;
         }
         return _adapter.write(seg);
     }
 
+    //! \brief Read a segment of any connection from the underlying AdapterT instance, potentially dropping it
+    //! \returns empty if the segment was dropped or if the underlying AdapterT returned an empty value
+    std::optional<std::pair<FourTuple, TCPSegment>> read_flow() {
+        auto ret = _adapter.read_flow();
+        if (_should_drop(false)) {
+            return {};
+        }
+        return ret;
+    }
+
+    //! \brief Write a segment of connection `flow` to the underlying AdapterT instance, or drop it
+    void write_flow(const FourTuple &flow, TCPSegment &seg) {
+        if (seg.gso_size() > 0 and _adapter.config().loss_rate_up != 0) {
+            for (auto &piece : seg.gso_split()) {
+                write_flow(flow, piece);
+            }
+            return;
+        }
+        if (_should_drop(true)) {
+            return;
+        }
+        return _adapter.write_flow(flow, seg);
+    }
+
     //! \name
     //! Passthrough functions to the underlying AdapterT instance
 
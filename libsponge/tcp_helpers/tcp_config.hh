@@ -12,14 +12,84 @@
 class TCPConfig {
   public:
     static constexpr size_t DEFAULT_CAPACITY = 64000;  //!< Default capacity
+    //! Default limit on how far buffer_autotuning grows each buffer
+    static constexpr size_t DEFAULT_MAX_CAPACITY = 4 * 1024 * 1024;
     static constexpr size_t MAX_PAYLOAD_SIZE = 1000;   //!< Conservative max payload size for real Internet
+    //! Largest payload that still fits in one UDP datagram (or IPv4 datagram) with a maximal TCP header,
+    //! for links such as loopback or a tun device that have no real MTU to respect
+    static constexpr size_t MAX_JUMBO_PAYLOAD_SIZE = 65507 - 60;
     static constexpr uint16_t TIMEOUT_DFLT = 1000;     //!< Default re-transmit timeout is 1 second
     static constexpr unsigned MAX_RETX_ATTEMPTS = 8;   //!< Maximum re-transmit attempts before giving up
+    static constexpr uint16_t MIN_RTO_DFLT = 200;      //!< Default lower bound on an adaptive RTO
+    static constexpr uint32_t MAX_RTO_DFLT = 60000;    //!< Default upper bound on an adaptive RTO
+    //! Largest payload of a GSO super-segment (see TCPSegment::gso_size), as for Linux's GSO
+    static constexpr size_t MAX_GSO_PAYLOAD_SIZE = 65536;
+
+    //! Congestion-control algorithms the TCPSender can use (see congestion_control.hh)
+    enum class CongestionAlgorithm {
+        None,     //!< no congestion window: send as much as the receiver's window allows
+        NewReno,  //!< slow start and AIMD ([RFC 5681](\ref rfc::rfc5681))
+        Cubic,    //!< cubic window growth ([RFC 9438](\ref rfc::rfc9438))
+    };
 
     uint16_t rt_timeout = TIMEOUT_DFLT;       //!< Initial value of the retransmission timeout, in milliseconds
     size_t recv_capacity = DEFAULT_CAPACITY;  //!< Receive capacity, in bytes
     size_t send_capacity = DEFAULT_CAPACITY;  //!< Sender capacity, in bytes
+    //! Largest payload to put in one segment; advertised to the peer as our MSS, and lowered to the peer's MSS
+    //! \note Capped at MAX_JUMBO_PAYLOAD_SIZE, so that every segment fits in one datagram
+    size_t max_payload_size = MAX_PAYLOAD_SIZE;
     std::optional<WrappingInt32> fixed_isn{};
+    CongestionAlgorithm congestion_control = CongestionAlgorithm::None;  //!< Sender congestion control
+    //! Estimate the retransmission timeout from measured RTTs ([RFC 6298](\ref rfc::rfc6298)),
+    //! starting from rt_timeout, instead of using rt_timeout for the whole connection
+    bool adaptive_rto = false;
+    uint16_t min_rto = MIN_RTO_DFLT;  //!< Lower bound on the adaptive RTO, in milliseconds
+    uint32_t max_rto = MAX_RTO_DFLT;  //!< Upper bound on the adaptive RTO (also caps its backoff), in milliseconds
+    //! Retransmit on the third duplicate ACK and recover NewReno-style ([RFC 6582](\ref rfc::rfc6582))
+    //! instead of waiting for the retransmission timer
+    bool fast_retransmit = false;
+    //! Offer selective acknowledgments ([RFC 2018](\ref rfc::rfc2018)); when the peer agrees, loss recovery
+    //! retransmits only the holes the peer reports ([RFC 6675](\ref rfc::rfc6675)). Implies fast_retransmit.
+    bool sack = false;
+    //! Offer window scaling ([RFC 7323](\ref rfc::rfc7323)) so that a recv_capacity above 65535 bytes can be
+    //! advertised, and the peer's window can exceed it too
+    //! \note Turning it on does not raise recv_capacity, which stays at DEFAULT_CAPACITY (the existing tests pin
+    //! that default): set a larger recv_capacity, or buffer_autotuning, to actually advertise more than 64 KB
+    bool window_scaling = false;
+    //! Offer the timestamps option ([RFC 7323](\ref rfc::rfc7323)); when the peer agrees, every segment carries
+    //! the sender's clock and echoes the peer's, so that every ACK of new data (even of a retransmission) gives
+    //! an RTT sample, and old duplicate segments are rejected by PAWS
+    bool timestamps = false;
+    //! Delay the ACK for in-order data by up to this many milliseconds, ACKing at least every second
+    //! segment and at once for out-of-order data or a FIN ([RFC 5681](\ref rfc::rfc5681) section 4.2);
+    //! 0 ACKs every segment immediately
+    uint16_t delayed_ack_timeout = 0;
+    //! Nagle's algorithm ([RFC 896](\ref rfc::rfc896)): while data is unacknowledged, hold back a segment
+    //! smaller than the MSS until more data fills it or the outstanding data is acknowledged
+    bool nagle = false;
+    //! Pace new data over the smoothed RTT instead of sending the whole window in one burst: a token bucket,
+    //! refilled on every tick at twice the send window per RTT in slow start and 1.2 times it otherwise
+    //! (the ratios Linux uses), limits what fill_window() may send. Pacing starts with the first RTT sample.
+    bool pacing = false;
+    //! Generic segmentation offload: the sender emits super-segments of up to MAX_GSO_PAYLOAD_SIZE bytes,
+    //! and the FdAdapter splits each into wire-sized segments just before sending them, so the per-segment
+    //! work between the TCPSender and the adapter is done once per super-segment
+    bool gso = false;
+    //! Receive coalescing: TCPSpongeSocket reads every datagram that is ready, merges runs of in-order data
+    //! segments into one segment (see TCPSegment::coalesce) and hands each merged segment to the
+    //! TCPConnection at once, which then ACKs the whole run with one segment
+    bool gro = false;
+    //! Size the buffers to the connection instead of fixing them at send_capacity and recv_capacity: the send
+    //! buffer grows toward twice the send window (the smaller of cwnd and the peer's window), and the receive
+    //! buffer toward twice the data that arrives in one smoothed RTT (like Linux's receive buffer autotuning, at
+    //! most doubling per RTT), up to send_capacity_max and recv_capacity_max. Once the connection has been idle for
+    //! an RTO, the send buffer goes back to send_capacity and the receive buffers' memory is freed (the receive
+    //! capacity itself never shrinks, so the advertised window never retreats). Use it with congestion control:
+    //! without it, the sender fills the grown peer window in one burst.
+    bool buffer_autotuning = false;
+    size_t send_capacity_max = DEFAULT_MAX_CAPACITY;  //!< Largest send capacity buffer_autotuning may reach
+    //! Largest receive capacity buffer_autotuning may reach (also sizes the window scale we offer)
+    size_t recv_capacity_max = DEFAULT_MAX_CAPACITY;
 };
 
 //! Config for classes derived from FdAdapter
@@ -0,0 +1,257 @@
+#include "tcp_demux.hh"
+
+#include "util.hh"
+
+#include <stdexcept>
+
+using namespace std;
+
+//! Most ready datagrams that one TCPDemuxLoop::wait_next_event() dispatches before it ticks the connections
+static constexpr size_t MAX_DATAGRAM_BATCH = 256;
+
+string FourTuple::to_string() const {
+    return Address::from_ipv4_numeric(local_address, local_port).to_string() + " <-> " +
+           Address::from_ipv4_numeric(remote_address, remote_port).to_string();
+}
+
+void TCPDemux::listen(const uint16_t port, const TCPConfig &config, const size_t backlog) {
+    Listener &listener = _listeners[port];
+    listener.config = config;
+    listener.backlog = backlog;
+}
+
+void TCPDemux::connect(const TCPConfig &config, const FourTuple &flow) {
+    if (contains(flow)) {
+        throw runtime_error("connect() to " + flow.to_string() + ", which is already in use");
+    }
+    Flow &f = _flows.insert(flow, Flow{make_unique<TCPConnection>(config), false, _timers.now(), {}});
+    f.connection->connect();
+    collect(flow, *f.connection);
+    arm(flow, f);
+}
+
+optional<FourTuple> TCPDemux::accept() {
+    for (auto &[port, listener] : _listeners) {
+        // 已经关闭并被移除的连接不再交给 accept
+        while (not listener.accept_queue.empty()) {
+            const FourTuple flow = listener.accept_queue.front();
+            listener.accept_queue.pop_front();
+            if (contains(flow)) {
+                return flow;
+            }
+        }
+    }
+    return {};
+}
+
+void TCPDemux::segment_received(const FourTuple &flow, const TCPSegment &seg) {
+    Flow *f = _flows.find(flow);
+    if (f == nullptr) {
+        // 不属于任何连接: 发往监听端口的 SYN 新建一个连接, 其余的回复 RST
+        const TCPHeader &header = seg.header();
+        const auto listener = _listeners.find(flow.local_port);
+        if (listener == _listeners.end() or not header.syn or header.ack or header.rst) {
+            if (not header.rst) {
+                send_reset(flow, seg);
+            }
+            return;
+        }
+        // backlog 满了, 或者内存紧张 (MemoryLedger 超过了软限制), 就丢弃 SYN, 对端会重传
+        if (listener->second.embryonic + listener->second.accept_queue.size() >= listener->second.backlog or
+            MemoryLedger::global().pressure() != MemoryPressure::None) {
+            _refused_syns++;
+            return;
+        }
+        f = &_flows.insert(flow, Flow{make_unique<TCPConnection>(listener->second.config), true, _timers.now(), {}});
+        listener->second.embryonic++;
+    }
+
+    catch_up(*f);
+    TCPConnection &connection = *f->connection;
+    connection.segment_received(seg);
+    collect(flow, connection);
+
+    // 被动打开的连接完成了握手 (离开了 SYN_RCVD), 放进 accept 队列
+    const bool syn_rcvd = connection.receiver_state() == TCPReceiverState::SYN_RECV and
+                          connection.sender_state() == TCPSenderState::SYN_SENT;
+    if (f->embryonic and connection.active() and not syn_rcvd) {
+        handshake_done(flow, *f);
+        _listeners.at(flow.local_port).accept_queue.push_back(flow);
+    }
+    settle(flow, *f);
+}
+
+// 只有定时器到期的连接才会被访问, 其余的连接在下次被用到时再补上错过的时间
+void TCPDemux::tick(const size_t ms_since_last_tick) {
+    _timers.advance(_timers.now() + ms_since_last_tick,
+                    [&](const uint64_t expiry, const FourTuple &flow) { timer_expired(expiry, flow); });
+}
+
+void TCPDemux::timer_expired(const uint64_t expiry, const FourTuple &flow) {
+    Flow *f = _flows.find(flow);
+    // 连接已经移除, 或者这个定时器已被更早的定时器取代
+    if (f == nullptr or f->deadline != expiry) {
+        return;
+    }
+    f->deadline.reset();
+    catch_up(*f);
+    collect(flow, *f->connection);
+    settle(flow, *f);
+}
+
+void TCPDemux::catch_up(Flow &f) {
+    if (f.ticked < _timers.now()) {
+        f.connection->tick(_timers.now() - f.ticked);
+        f.ticked = _timers.now();
+    }
+}
+
+void TCPDemux::arm(const FourTuple &flow, Flow &f) {
+    const TCPConnection &connection = *f.connection;
+    const optional<uint64_t> timeout = connection.active() ? connection.next_timeout() : nullopt;
+    if (not timeout.has_value()) {
+        return;
+    }
+    // 已有的定时器更早到期就不用再登记: 它到期时会按那时的 next_timeout() 重新登记
+    const uint64_t expiry = _timers.now() + max<uint64_t>(timeout.value(), 1);
+    if (not f.deadline.has_value() or expiry < f.deadline.value()) {
+        f.deadline = expiry;
+        _timers.schedule(expiry, flow);
+    }
+}
+
+// 关闭了的连接不再有定时器, 等应用通过 read() 读完收到的数据时移除
+void TCPDemux::settle(const FourTuple &flow, Flow &f) {
+    if (f.connection->active()) {
+        arm(flow, f);
+        return;
+    }
+    if (f.connection->inbound_stream().buffer_empty()) {
+        if (f.embryonic) {
+            handshake_done(flow, f);
+        }
+        _flows.erase(flow);
+    }
+}
+
+size_t TCPDemux::write(const FourTuple &flow, Buffer data) {
+    Flow &f = flow_mut(flow);
+    catch_up(f);
+    const size_t len = f.connection->write(move(data));
+    collect(flow, *f.connection);
+    settle(flow, f);
+    return len;
+}
+
+void TCPDemux::end_input_stream(const FourTuple &flow) {
+    Flow &f = flow_mut(flow);
+    catch_up(f);
+    f.connection->end_input_stream();
+    collect(flow, *f.connection);
+    settle(flow, f);
+}
+
+string TCPDemux::read(const FourTuple &flow, const size_t len) {
+    Flow &f = flow_mut(flow);
+    string data = f.connection->inbound_stream().read(len);
+    settle(flow, f);
+    return data;
+}
+
+const TCPConnection &TCPDemux::connection(const FourTuple &flow) const {
+    const Flow *f = _flows.find(flow);
+    if (f == nullptr) {
+        throw runtime_error("no connection " + flow.to_string());
+    }
+    return *f->connection;
+}
+
+TCPDemux::Flow &TCPDemux::flow_mut(const FourTuple &flow) {
+    Flow *f = _flows.find(flow);
+    if (f == nullptr) {
+        throw runtime_error("no connection " + flow.to_string());
+    }
+    return *f;
+}
+
+void TCPDemux::collect(const FourTuple &flow, TCPConnection &connection) {
+    while (not connection.segments_out().empty()) {
+        _segments_out.emplace(flow, move(connection.segments_out().front()));
+        connection.segments_out().pop();
+    }
+}
+
+// RFC 793 第 3.4 节: 带 ACK 的 segment 用它的 ackno 作为 RST 的 seqno, 否则 RST 确认它占用的序号
+void TCPDemux::send_reset(const FourTuple &flow, const TCPSegment &seg) {
+    TCPSegment rst;
+    rst.header().rst = true;
+    if (seg.header().ack) {
+        rst.header().seqno = seg.header().ackno;
+    } else {
+        rst.header().ack = true;
+        rst.header().ackno = seg.header().seqno + seg.length_in_sequence_space();
+    }
+    _segments_out.emplace(flow, move(rst));
+}
+
+void TCPDemux::handshake_done(const FourTuple &flow, Flow &f) {
+    f.embryonic = false;
+    _listeners.at(flow.local_port).embryonic--;
+}
+
+//! \param[in] datagram_interface is the interface for reading and writing datagrams
+template <typename AdaptT>
+TCPDemuxLoop<AdaptT>::TCPDemuxLoop(AdaptT &&datagram_interface)
+    : _datagram_adapter(move(datagram_interface)), _base_time(timestamp_ms()) {
+    // 收到的数据报按 FourTuple 交给对应的连接
+    _eventloop.add_rule(_datagram_adapter, Direction::In, [&] {
+        auto received = _datagram_adapter.read_flow();
+        if (received) {
+            _demux.segment_received(received->first, received->second);
+        }
+    });
+}
+
+//! \param[in] timeout_ms is the longest to wait for the first datagram
+template <typename AdaptT>
+void TCPDemuxLoop<AdaptT>::wait_next_event(const int timeout_ms) {
+    const auto send_segments = [&] {
+        auto &segments_out = _demux.segments_out();
+        while (not segments_out.empty()) {
+            _datagram_adapter.write_flow(segments_out.front().first, segments_out.front().second);
+            segments_out.pop();
+        }
+    };
+
+    // 先发出应用在两次调用之间 (write 等) 产生的 segment, 再等待并处理所有就绪的数据报
+    send_segments();
+    auto ret = _eventloop.wait_next_event(timeout_ms);
+    for (size_t i = 1; ret == EventLoop::Result::Success and i < MAX_DATAGRAM_BATCH; i++) {
+        send_segments();
+        ret = _eventloop.wait_next_event(0);
+    }
+    if (ret == EventLoop::Result::Exit) {
+        throw runtime_error("TCPDemuxLoop: the datagram interface was closed");
+    }
+
+    // 时间前进了才 tick
+    const auto now = timestamp_ms();
+    if (now > _base_time) {
+        _demux.tick(now - _base_time);
+        _datagram_adapter.tick(now - _base_time);
+        _base_time = now;
+    }
+    send_segments();
+}
+
+//! Specialization of TCPDemuxLoop for TCPOverUDPSocketAdapter
+template class TCPDemuxLoop<TCPOverUDPSocketAdapter>;
+
+//! Specialization of TCPDemuxLoop for TCPOverIPv4OverTunFdAdapter
+template class TCPDemuxLoop<TCPOverIPv4OverTunFdAdapter>;
+
+//! Specialization of TCPDemuxLoop for LossyTCPOverUDPSocketAdapter
+template class TCPDemuxLoop<LossyTCPOverUDPSocketAdapter>;
+
+//! Specialization of TCPDemuxLoop for LossyTCPOverIPv4OverTunFdAdapter
+template class TCPDemuxLoop<LossyTCPOverIPv4OverTunFdAdapter>;
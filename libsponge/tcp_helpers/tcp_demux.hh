@@ -0,0 +1,198 @@
+#ifndef SPONGE_LIBSPONGE_TCP_DEMUX_HH
+#define SPONGE_LIBSPONGE_TCP_DEMUX_HH
+
+#include "buffer.hh"
+#include "byte_stream.hh"
+#include "eventloop.hh"
+#include "fd_adapter.hh"
+#include "flow_table.hh"
+#include "memory_ledger.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_segment.hh"
+#include "timer_wheel.hh"
+#include "tuntap_adapter.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+//! \brief Many TCPConnections behind one datagram interface, found by their FourTuple
+//! \details Inbound segments are dispatched to the connection their FourTuple names. A segment for no
+//! known connection is a new connection if it is a SYN to a port passed to listen(): the connection is
+//! created with that port's TCPConfig and, once its handshake completes, is queued for accept().
+//! Anything else is answered with a RST, as the kernel does for a closed port. While MemoryLedger::global()
+//! is under pressure, new connections are refused: their SYNs are dropped, as when the backlog is full.
+//!
+//! Outbound segments of every connection are collected in one queue, each with its FourTuple,
+//! for the owner to write to the datagram interface (see TCPDemuxLoop).
+//!
+//! Connections are ticked lazily: each one has a timer on a TimerWheel for its TCPConnection::next_timeout(),
+//! and tick() only visits the connections whose timers fire. A connection that is used in between is first
+//! ticked by the time it missed, so it sees the same clock as if it had been ticked all along.
+//!
+//! A connection that has closed has no timer. It is removed as soon as its inbound data has been read
+//! with read() (or right away, if there was none left to read).
+class TCPDemux {
+  private:
+    //! a connection, and whether it still counts against its listener's backlog
+    struct Flow {
+        std::unique_ptr<TCPConnection> connection{};
+        bool embryonic = false;  //!< passively opened, handshake not complete yet (not in the accept queue)
+        uint64_t ticked = 0;     //!< the time (on _timers) up to which the connection has been ticked
+        std::optional<uint64_t> deadline{};  //!< expiry of the timer that will next visit the connection
+    };
+
+    //! a port passed to listen()
+    struct Listener {
+        TCPConfig config{};
+        size_t backlog = 0;
+        size_t embryonic = 0;                 //!< connections still in their handshake
+        std::deque<FourTuple> accept_queue{};  //!< connections that completed the handshake, oldest first
+    };
+
+    FlowTable<Flow> _flows{};
+    std::unordered_map<uint16_t, Listener> _listeners{};
+
+    //! outbound segments of every connection, in the order they were generated
+    std::queue<std::pair<FourTuple, TCPSegment>> _segments_out{};
+
+    //! each connection's next timeout (stale timers, for a deadline that was moved, are ignored when they fire)
+    TimerWheel<FourTuple> _timers{};
+
+    //! SYNs dropped because the backlog was full or memory was under pressure
+    size_t _refused_syns = 0;
+
+    Flow &flow_mut(const FourTuple &flow);
+
+    //! Tick the connection by the time that passed since it was last ticked
+    void catch_up(Flow &f);
+
+    //! Make sure a timer will visit the connection by its next timeout (none once it has closed)
+    void arm(const FourTuple &flow, Flow &f);
+
+    //! After the connection was used: remove it if it has closed and its inbound data was read, else arm() it
+    void settle(const FourTuple &flow, Flow &f);
+
+    //! A timer for `flow` fired: tick the connection, then settle() it
+    void timer_expired(const uint64_t expiry, const FourTuple &flow);
+
+    //! Move the segments `connection` has queued to _segments_out
+    void collect(const FourTuple &flow, TCPConnection &connection);
+
+    //! Answer `seg`, which belongs to no connection, with a RST
+    void send_reset(const FourTuple &flow, const TCPSegment &seg);
+
+    //! A passive connection finished its handshake or died in it: stop counting it against the backlog
+    void handshake_done(const FourTuple &flow, Flow &f);
+
+  public:
+    //! \brief Accept connections to local port `port` with configuration `config`
+    //! \param backlog the most connections that may be in their handshake or waiting for accept() at once;
+    //! SYNs beyond that are dropped (the peer retransmits them)
+    void listen(const uint16_t port, const TCPConfig &config, const size_t backlog = 128);
+
+    //! \brief Open a connection actively, sending its SYN
+    //! \throws std::runtime_error if `flow` is already in use
+    void connect(const TCPConfig &config, const FourTuple &flow);
+
+    //! \brief The next connection that completed its handshake on a listening port, if any
+    std::optional<FourTuple> accept();
+
+    //! \brief Dispatch an inbound segment to its connection
+    void segment_received(const FourTuple &flow, const TCPSegment &seg);
+
+    //! \brief Tick the connections whose timers expire, and remove the ones that close and have no
+    //! inbound data left to read
+    void tick(const size_t ms_since_last_tick);
+
+    //! \name Per-connection operations
+    //! \throws std::runtime_error if there is no connection `flow`
+    //!@{
+
+    //! \brief Write data to the connection's outbound stream
+    //! \returns the number of bytes written
+    size_t write(const FourTuple &flow, Buffer data);
+
+    //! \brief Shut down the connection's outbound stream
+    void end_input_stream(const FourTuple &flow);
+
+    //! \brief Read up to `len` bytes from the connection's inbound stream
+    //! \details A connection that has closed is removed once this has read all of its inbound data.
+    std::string read(const FourTuple &flow, const size_t len);
+
+    //! \brief The connection's inbound stream (read it with read())
+    const ByteStream &inbound_stream(const FourTuple &flow) const { return connection(flow).inbound_stream(); }
+
+    //! \brief The connection itself (for its state and statistics)
+    //! \note Its clocks (e.g. TCPConnection::time_since_last_segment_received()) may lag behind, since it is
+    //! only ticked when used or when one of its timers fires
+    const TCPConnection &connection(const FourTuple &flow) const;
+    //!@}
+
+    //! \brief Whether `flow` is a connection (it may already be closed)
+    bool contains(const FourTuple &flow) const { return _flows.find(flow) != nullptr; }
+
+    //! \brief Number of connections, including closed ones not removed yet
+    size_t size() const { return _flows.size(); }
+
+    //! \brief Number of connection timers waiting to fire, including ones superseded by an earlier deadline
+    size_t pending_timers() const { return _timers.size(); }
+
+    //! \brief Number of SYNs dropped because a listener's backlog was full or memory was under pressure
+    size_t refused_syns() const { return _refused_syns; }
+
+    //! \brief Outbound segments of every connection, each with the connection it belongs to
+    std::queue<std::pair<FourTuple, TCPSegment>> &segments_out() { return _segments_out; }
+};
+
+//! \brief One event loop serving every connection of a TCPDemux over one datagram interface
+//! \details A single thread calls wait_next_event() (and the TCPDemux methods, in between),
+//! instead of one TCPSpongeSocket thread per connection.
+template <typename AdaptT>
+class TCPDemuxLoop {
+  private:
+    AdaptT _datagram_adapter;
+    TCPDemux _demux{};
+    EventLoop _eventloop{};
+    uint64_t _base_time;
+
+  public:
+    //! Construct from the interface that every connection will read and write datagrams through
+    explicit TCPDemuxLoop(AdaptT &&datagram_interface);
+
+    //! \brief Wait up to `timeout_ms` for datagrams, dispatch every datagram that is ready, tick
+    //! the connections by the time that passed, and write out every segment they queued
+    void wait_next_event(const int timeout_ms);
+
+    //! The connections
+    TCPDemux &demux() { return _demux; }
+
+    //! The datagram interface
+    AdaptT &adapter() { return _datagram_adapter; }
+
+    //! \name
+    //! The rules refer to this object, so it cannot be moved or copied
+
+    //!@{
+    TCPDemuxLoop(const TCPDemuxLoop &) = delete;
+    TCPDemuxLoop(TCPDemuxLoop &&) = delete;
+    TCPDemuxLoop &operator=(const TCPDemuxLoop &) = delete;
+    TCPDemuxLoop &operator=(TCPDemuxLoop &&) = delete;
+    ~TCPDemuxLoop() = default;
+    //!@}
+};
+
+using TCPOverUDPDemuxLoop = TCPDemuxLoop<TCPOverUDPSocketAdapter>;
+using TCPOverIPv4DemuxLoop = TCPDemuxLoop<TCPOverIPv4OverTunFdAdapter>;
+
+using LossyTCPOverUDPDemuxLoop = TCPDemuxLoop<LossyTCPOverUDPSocketAdapter>;
+using LossyTCPOverIPv4DemuxLoop = TCPDemuxLoop<LossyTCPOverIPv4OverTunFdAdapter>;
+
+#endif  // SPONGE_LIBSPONGE_TCP_DEMUX_HH
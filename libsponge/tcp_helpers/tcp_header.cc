@@ -37,8 +37,49 @@ ParseResult TCPHeader::parse(NetParser &p) {
         return ParseResult::HeaderTooShort;
     }
 
-    // skip any options or anything extra in the header
-    p.remove_prefix(doff * 4 - TCPHeader::LENGTH);
+    // parse the options we understand, and skip any others or anything extra in the header
+    mss.reset();
+    sack_permitted = false;
+    wscale.reset();
+    timestamps.reset();
+    sack.clear();
+    size_t remaining = doff * 4 - TCPHeader::LENGTH;
+    while (remaining > 0 and not p.error()) {
+        const uint8_t kind = p.u8();
+        remaining--;
+        if (kind == OPT_EOL) {
+            break;
+        }
+        if (kind == OPT_NOP) {
+            continue;
+        }
+
+        // every other option has a length byte that counts the kind and length bytes too
+        const uint8_t len = remaining > 0 ? p.u8() : 0;
+        remaining -= remaining > 0 ? 1 : 0;
+        if (len < 2 or len - 2u > remaining) {
+            break;  // malformed option list: ignore the rest of it
+        }
+        if (kind == OPT_MSS and len == 4) {
+            mss = p.u16();
+        } else if (kind == OPT_WSCALE and len == 3) {
+            wscale = p.u8();
+        } else if (kind == OPT_SACK_PERMITTED and len == 2) {
+            sack_permitted = true;
+        } else if (kind == OPT_TIMESTAMPS and len == 10) {
+            const uint32_t tsval = p.u32();
+            timestamps = TCPTimestamps{tsval, p.u32()};
+        } else if (kind == OPT_SACK and len % 8 == 2) {
+            for (size_t i = 0; i < len / 8u; i++) {
+                const WrappingInt32 left{p.u32()};
+                sack.push_back({left, WrappingInt32{p.u32()}});
+            }
+        } else {
+            p.remove_prefix(len - 2);
+        }
+        remaining -= len - 2;
+    }
+    p.remove_prefix(remaining);
 
     if (p.error()) {
         return p.get_error();
@@ -47,6 +88,26 @@ ParseResult TCPHeader::parse(NetParser &p) {
     return ParseResult::NoError;
 }
 
+size_t TCPHeader::options_length() const {
+    size_t len = 0;
+    if (mss.has_value()) {
+        len += 4;
+    }
+    if (sack_permitted) {
+        len += 2;
+    }
+    if (wscale.has_value()) {
+        len += 4;
+    }
+    if (timestamps.has_value()) {
+        len += 12;
+    }
+    if (not sack.empty()) {
+        len += 4 + 8 * sack.size();
+    }
+    return (len + 3) / 4 * 4;
+}
+
 //! Serialize the TCPHeader to a string (does not recompute the checksum)
 string TCPHeader::serialize() const {
     // sanity check
@@ -72,7 +133,43 @@ string TCPHeader::serialize() const {
 
     NetUnparser::u16(ret, uptr);  // urgent pointer
 
-    ret.resize(4 * doff);  // expand header to advertised size
+    // options, each only if it fits in the advertised header size
+    const auto fits = [&](const size_t len) { return ret.size() + len <= 4 * size_t(doff); };
+    if (mss.has_value() and fits(4)) {
+        NetUnparser::u8(ret, OPT_MSS);
+        NetUnparser::u8(ret, 4);
+        NetUnparser::u16(ret, mss.value());
+    }
+    if (sack_permitted and fits(2)) {
+        NetUnparser::u8(ret, OPT_SACK_PERMITTED);
+        NetUnparser::u8(ret, 2);
+    }
+    if (wscale.has_value() and fits(4)) {
+        NetUnparser::u8(ret, OPT_NOP);
+        NetUnparser::u8(ret, OPT_WSCALE);
+        NetUnparser::u8(ret, 3);
+        NetUnparser::u8(ret, wscale.value());
+    }
+    if (timestamps.has_value() and fits(12)) {
+        NetUnparser::u8(ret, OPT_NOP);
+        NetUnparser::u8(ret, OPT_NOP);
+        NetUnparser::u8(ret, OPT_TIMESTAMPS);
+        NetUnparser::u8(ret, 10);
+        NetUnparser::u32(ret, timestamps->tsval);
+        NetUnparser::u32(ret, timestamps->tsecr);
+    }
+    if (not sack.empty() and fits(4 + 8 * sack.size())) {
+        NetUnparser::u8(ret, OPT_NOP);
+        NetUnparser::u8(ret, OPT_NOP);
+        NetUnparser::u8(ret, OPT_SACK);
+        NetUnparser::u8(ret, 2 + 8 * sack.size());
+        for (const auto &block : sack) {
+            NetUnparser::u32(ret, block.left.raw_value());
+            NetUnparser::u32(ret, block.right.raw_value());
+        }
+    }
+
+    ret.resize(4 * doff);  // expand header to advertised size (zero padding is OPT_EOL)
 
     return ret;
 }
@@ -90,6 +187,21 @@ string TCPHeader::to_string() const {
        << "TCP winsize: " << +win << '\n'
        << "TCP cksum: " << +cksum << '\n'
        << "TCP uptr: " << +uptr << '\n';
+    if (mss.has_value()) {
+        ss << "TCP MSS option: " << +mss.value() << '\n';
+    }
+    if (sack_permitted) {
+        ss << "TCP SACK-permitted option\n";
+    }
+    if (wscale.has_value()) {
+        ss << "TCP window scale option: " << +wscale.value() << '\n';
+    }
+    if (timestamps.has_value()) {
+        ss << "TCP timestamps option: " << timestamps->tsval << " echo " << timestamps->tsecr << '\n';
+    }
+    for (const auto &block : sack) {
+        ss << "TCP SACK block: " << block.left << "-" << block.right << '\n';
+    }
     return ss.str();
 }
 
@@ -4,11 +4,40 @@
 #include "parser.hh"
 #include "wrapping_integers.hh"
 
+#include <optional>
+#include <vector>
+
+//! \brief A [SACK](\ref rfc::rfc2018) block: the receiver holds the sequence numbers [left, right)
+struct SACKBlock {
+    WrappingInt32 left;   //!< first sequence number of the block
+    WrappingInt32 right;  //!< sequence number just past the block
+};
+
+//! \brief The [timestamps](\ref rfc::rfc7323) option: the sender's clock, and the peer's clock echoed back
+struct TCPTimestamps {
+    uint32_t tsval;  //!< timestamp value: the sender's clock when the segment was sent
+    uint32_t tsecr;  //!< timestamp echo reply: the most recent tsval the sender received (only valid with ACK)
+};
+
 //! \brief [TCP](\ref rfc::rfc793) segment header
-//! \note TCP options are not supported
+//! \note Only the options listed under "TCP options" are understood; others are skipped when parsing
 struct TCPHeader {
     static constexpr size_t LENGTH = 20;  //!< [TCP](\ref rfc::rfc793) header length, not including options
 
+    //! \name TCP option kinds
+    //!@{
+    static constexpr uint8_t OPT_EOL = 0;  //!< end of option list
+    static constexpr uint8_t OPT_NOP = 1;  //!< no-operation (padding)
+    static constexpr uint8_t OPT_MSS = 2;             //!< maximum segment size
+    static constexpr uint8_t OPT_WSCALE = 3;          //!< window scale
+    static constexpr uint8_t OPT_SACK_PERMITTED = 4;  //!< selective acknowledgments may be used
+    static constexpr uint8_t OPT_SACK = 5;            //!< selective acknowledgment blocks
+    static constexpr uint8_t OPT_TIMESTAMPS = 8;      //!< timestamps
+    //!@}
+
+    static constexpr size_t MAX_OPTIONS_LENGTH = 40;  //!< options can take at most 40 bytes (doff = 15)
+    static constexpr uint8_t MAX_WINDOW_SHIFT = 14;   //!< largest window scale allowed by RFC 7323
+
     //! \struct TCPHeader
     //! ~~~{.txt}
     //!   0                   1                   2                   3
@@ -50,6 +79,22 @@ struct TCPHeader {
     uint16_t uptr = 0;          //!< urgent pointer
     //!@}
 
+    //! \name TCP options
+    //! \note serialize() only writes the options that fit in the `doff` words of the header,
+    //! so whoever sets an option must also grow `doff` (see options_length())
+    //!@{
+    std::optional<uint16_t> mss{};  //!< maximum segment size the sender is willing to receive (SYN only)
+    bool sack_permitted = false;    //!< the sender can receive SACK blocks (SYN only)
+    //! shift count the sender will apply to the windows it advertises (SYN only, written after a NOP)
+    std::optional<uint8_t> wscale{};
+    //! the sender's clock, and the most recent clock value it received from the peer (written after two NOPs)
+    std::optional<TCPTimestamps> timestamps{};
+    std::vector<SACKBlock> sack{};  //!< blocks of data the sender holds above ackno (written after two NOPs)
+    //!@}
+
+    //! \returns the number of bytes the set options occupy on the wire, padded to a multiple of 4
+    size_t options_length() const;
+
     //! Parse the TCP fields from the provided NetParser
     ParseResult parse(NetParser &p);
 
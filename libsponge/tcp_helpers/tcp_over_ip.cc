@@ -73,14 +73,41 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
 //! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
 //! \param[in] seg is the TCP segment to convert
 InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
+    const FourTuple flow{config().source.ipv4_numeric(),
+                         config().source.port(),
+                         config().destination.ipv4_numeric(),
+                         config().destination.port()};
+    return wrap_tcp_in_ip(flow, seg);
+}
+
+//! \details Unlike unwrap_tcp_in_ip(), this does no filtering on addresses or ports, and never changes the
+//! configuration: the datagram's destination is the local end of the FourTuple, and its source the remote end.
+optional<pair<FourTuple, TCPSegment>> TCPOverIPv4Adapter::unwrap_tcp_flow(const InternetDatagram &ip_dgram) {
+    if (ip_dgram.header().proto != IPv4Header::PROTO_TCP) {
+        return {};
+    }
+
+    TCPSegment tcp_seg;
+    if (ParseResult::NoError != tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
+        return {};
+    }
+
+    const FourTuple flow{
+        ip_dgram.header().dst, tcp_seg.header().dport, ip_dgram.header().src, tcp_seg.header().sport};
+    return make_pair(flow, move(tcp_seg));
+}
+
+//! \param[in] flow is the connection the segment belongs to
+//! \param[in] seg is the TCP segment to convert
+InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(const FourTuple &flow, TCPSegment &seg) {
     // set the port numbers in the TCP segment
-    seg.header().sport = config().source.port();
-    seg.header().dport = config().destination.port();
+    seg.header().sport = flow.local_port;
+    seg.header().dport = flow.remote_port;
 
     // create an Internet Datagram and set its addresses and length
     InternetDatagram ip_dgram;
-    ip_dgram.header().src = config().source.ipv4_numeric();
-    ip_dgram.header().dst = config().destination.ipv4_numeric();
+    ip_dgram.header().src = flow.local_address;
+    ip_dgram.header().dst = flow.remote_address;
     ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
 
     // set payload, calculating TCP checksum using information from IP header
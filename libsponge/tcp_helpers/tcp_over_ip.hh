@@ -7,6 +7,7 @@
 #include "tcp_segment.hh"
 
 #include <optional>
+#include <utility>
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase {
@@ -14,6 +15,13 @@ class TCPOverIPv4Adapter : public FdAdapterBase {
     std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram);
 
     InternetDatagram wrap_tcp_in_ip(TCPSegment &seg);
+
+    //! \brief Parses the TCP segment in an IPv4 datagram, whichever connection it belongs to (for TCPDemux)
+    //! \returns the segment and its connection, or empty if the datagram does not hold a valid TCP segment
+    std::optional<std::pair<FourTuple, TCPSegment>> unwrap_tcp_flow(const InternetDatagram &ip_dgram);
+
+    //! \brief Wraps a TCP segment of connection `flow` in an IPv4 datagram
+    InternetDatagram wrap_tcp_in_ip(const FourTuple &flow, TCPSegment &seg);
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_OVER_IP_HH
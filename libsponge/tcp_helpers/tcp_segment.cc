@@ -3,6 +3,7 @@
 #include "parser.hh"
 #include "util.hh"
 
+#include <string>
 #include <variant>
 
 using namespace std;
@@ -22,8 +23,16 @@ ParseResult TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer
     return p.get_error();
 }
 
+size_t TCPSegment::payload_size() const {
+    size_t size = _payload.size();
+    for (const auto &frag : _frags) {
+        size += frag.size();
+    }
+    return size;
+}
+
 size_t TCPSegment::length_in_sequence_space() const {
-    return payload().str().size() + (header().syn ? 1 : 0) + (header().fin ? 1 : 0);
+    return payload_size() + (header().syn ? 1 : 0) + (header().fin ? 1 : 0);
 }
 
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
@@ -35,11 +44,102 @@ BufferList TCPSegment::serialize(const uint32_t datagram_layer_checksum) const {
     InternetChecksum check(datagram_layer_checksum);
     check.add(header_out.serialize());
     check.add(_payload);
+    for (const auto &frag : _frags) {
+        check.add(frag);
+    }
     header_out.cksum = check.value();
 
     BufferList ret;
     ret.append(header_out.serialize());
     ret.append(_payload);
+    for (const auto &frag : _frags) {
+        ret.append(frag);
+    }
 
     return ret;
 }
+
+vector<TCPSegment> TCPSegment::gso_split() const {
+    if (_gso_size == 0 or _payload.size() <= _gso_size) {
+        TCPSegment piece{*this};
+        piece._gso_size = 0;
+        return {piece};
+    }
+
+    vector<TCPSegment> pieces;
+    pieces.reserve((_payload.size() + _gso_size - 1) / _gso_size);
+    for (size_t offset = 0; offset < _payload.size(); offset += _gso_size) {
+        const size_t length = min(_gso_size, _payload.size() - offset);
+        const bool first = offset == 0;
+        const bool last = offset + length == _payload.size();
+
+        TCPSegment &piece = pieces.emplace_back();
+        piece._header = _header;
+        piece._header.syn = first and _header.syn;
+        if (not first) {
+            // the options only a SYN carries stay with the SYN
+            piece._header.mss.reset();
+            piece._header.wscale.reset();
+            piece._header.sack_permitted = false;
+        }
+        piece._header.fin = last and _header.fin;
+        piece._header.psh = last and _header.psh;
+        piece._header.seqno = first ? _header.seqno : _header.seqno + static_cast<uint32_t>(_header.syn + offset);
+        piece._payload = _payload;
+        piece._payload.remove_prefix(offset);
+        piece._payload.remove_suffix(_payload.size() - offset - length);
+    }
+    return pieces;
+}
+
+bool TCPSegment::can_coalesce(const TCPSegment &next) const {
+    const TCPHeader &h = _header;
+    const TCPHeader &n = next._header;
+    // never merge pure ACKs, or duplicate ACKs would be lost
+    if (_payload.size() == 0 or next._payload.size() == 0) {
+        return false;
+    }
+    if (h.syn or h.rst or h.urg or h.fin or not h.sack.empty() or n.syn or n.rst or n.urg or not n.sack.empty()) {
+        return false;
+    }
+    // as in Linux GRO, the options must match: the merged segment keeps only the last timestamps, and
+    // a receiver taking its RTT samples or PAWS check from them must not see a different clock than was sent
+    if (h.timestamps.has_value() != n.timestamps.has_value() or
+        (h.timestamps and (h.timestamps->tsval != n.timestamps->tsval or h.timestamps->tsecr != n.timestamps->tsecr))) {
+        return false;
+    }
+    return n.seqno == h.seqno + static_cast<uint32_t>(_payload.size()) and n.ack == h.ack and n.ackno == h.ackno;
+}
+
+vector<TCPSegment> TCPSegment::coalesce(vector<TCPSegment> &&segments) {
+    vector<TCPSegment> merged;
+    merged.reserve(segments.size());
+    size_t i = 0;
+    while (i < segments.size()) {
+        // find the run [i, j) of segments that continue one another
+        size_t j = i + 1;
+        size_t total = segments[i]._payload.size();
+        while (j < segments.size() and segments[j - 1].can_coalesce(segments[j]) and
+               total + segments[j]._payload.size() <= MAX_COALESCED_PAYLOAD_SIZE) {
+            total += segments[j]._payload.size();
+            j++;
+        }
+
+        if (j == i + 1) {
+            merged.push_back(move(segments[i]));
+        } else {
+            // chain the later payloads after the first instead of copying them into one string
+            vector<Buffer> frags;
+            frags.reserve(j - i - 1);
+            for (size_t k = i + 1; k < j; k++) {
+                frags.push_back(move(segments[k]._payload));
+            }
+            TCPSegment &seg = merged.emplace_back(move(segments[j - 1]));
+            seg._header.seqno = segments[i]._header.seqno;
+            seg._payload = move(segments[i]._payload);
+            seg._frags = move(frags);
+        }
+        i = j;
+    }
+    return merged;
+}
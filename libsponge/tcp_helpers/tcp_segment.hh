@@ -5,12 +5,15 @@
 #include "tcp_header.hh"
 
 #include <cstdint>
+#include <vector>
 
 //! \brief [TCP](\ref rfc::rfc793) segment
 class TCPSegment {
   private:
     TCPHeader _header{};
     Buffer _payload{};
+    std::vector<Buffer> _frags{};
+    size_t _gso_size{0};
 
   public:
     //! \brief Parse the segment from a string
@@ -26,10 +29,41 @@ class TCPSegment {
 
     const Buffer &payload() const { return _payload; }
     Buffer &payload() { return _payload; }
+
+    //! \brief Payloads chained after payload() by coalesce(), in sequence order (empty for a regular segment)
+    const std::vector<Buffer> &frags() const { return _frags; }
+
+    //! \brief Length of payload() plus the chained frags()
+    size_t payload_size() const;
+
+    //! \brief Payload bytes per wire segment if this is a GSO super-segment, or 0 for a regular segment
+    size_t gso_size() const { return _gso_size; }
+    size_t &gso_size() { return _gso_size; }
     //!@}
 
+    //! \brief Split a GSO super-segment into wire-sized segments
+    //! \details Each piece carries a copy of this segment's header with its own seqno,
+    //! and a slice of the payload that shares its storage. SYN, and the options only a SYN carries
+    //! (MSS, window scale, SACK-permitted), stay on the first piece, FIN and PSH on the last.
+    //! A regular segment is returned as the only piece.
+    std::vector<TCPSegment> gso_split() const;
+
+    //! \brief Largest payload that coalesce() builds, as for Linux's GRO
+    static constexpr size_t MAX_COALESCED_PAYLOAD_SIZE = 65536;
+
+    //! \brief Whether `next` carries the data right after this segment's, with the same ACK, the same
+    //! timestamps (or none in both), and no SYN, RST, URG or SACK blocks in either, so that coalesce() may
+    //! merge the two
+    bool can_coalesce(const TCPSegment &next) const;
+
+    //! \brief Merge each run of segments that continue one another into one segment (receive coalescing, GRO)
+    //! \details A merged segment has the first segment's seqno, the first payload as payload() with the
+    //! others chained in frags() (as with Linux's frag_list, no byte is copied), and otherwise the last
+    //! segment's header (window, FIN and PSH). Other segments are returned unchanged.
+    static std::vector<TCPSegment> coalesce(std::vector<TCPSegment> &&segments);
+
     //! \brief Segment's length in sequence space
-    //! \note Equal to payload length plus one byte if SYN is set, plus one byte if FIN is set
+    //! \note Equal to payload_size() plus one byte if SYN is set, plus one byte if FIN is set
     size_t length_in_sequence_space() const;
 };
 
@@ -18,14 +18,27 @@
 
 using namespace std;
 
-static constexpr size_t TCP_TICK_MS = 10;
+//! Longest the event loop sleeps while no timer of the connection is due (it still has to notice _abort)
+static constexpr size_t TCP_MAX_WAIT_MS = 100;
+
+//! Most datagrams read in one go before handing them to the TCPConnection (and coalescing them, with GRO)
+static constexpr size_t RECEIVE_MAX_BATCH = 64;
+
+//! Requests sent over TCPSpongeSocket::_control
+static constexpr char CONTROL_CORK = 'c';
+static constexpr char CONTROL_UNCORK = 'u';
 
 //! \param[in] condition is a function returning true if loop should continue
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
     auto base_time = timestamp_ms();
     while (condition()) {
-        auto ret = _eventloop.wait_next_event(TCP_TICK_MS);
+        // 在连接的下一个定时器 (重传, pacing, 延迟 ACK, linger) 到期时醒来, 而不是每隔固定的时间 tick 一次
+        size_t timeout = TCP_MAX_WAIT_MS;
+        if (_tcp.has_value() and _tcp->next_timeout().has_value()) {
+            timeout = min(timeout, static_cast<size_t>(_tcp->next_timeout().value()));
+        }
+        auto ret = _eventloop.wait_next_event(timeout);
         if (ret == EventLoop::Result::Exit or _abort) {
             break;
         }
@@ -40,19 +53,26 @@ void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
 }
 
 //! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
+//! \param[in] control_socket_pair is another such pair, for cork() and uncork()
 //! \param[in] datagram_interface is the interface for reading and writing datagrams
 template <typename AdaptT>
 TCPSpongeSocket<AdaptT>::TCPSpongeSocket(pair<FileDescriptor, FileDescriptor> data_socket_pair,
+                                         pair<FileDescriptor, FileDescriptor> control_socket_pair,
                                          AdaptT &&datagram_interface)
     : LocalStreamSocket(move(data_socket_pair.first))
     , _thread_data(move(data_socket_pair.second))
+    , _control(LocalStreamSocket(move(control_socket_pair.first)), LocalStreamSocket(move(control_socket_pair.second)))
     , _datagram_adapter(move(datagram_interface)) {
     _thread_data.set_blocking(false);
+    _control.second.set_blocking(false);
+    // rule 1 reads datagrams until one would block
+    static_cast<FileDescriptor &>(_datagram_adapter).set_blocking(false);
 }
 
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
     _tcp.emplace(config);
+    _gro = config.gro;
 
     // Set up the event loop
 
@@ -72,14 +92,44 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
     // 4) Outbound segment generated by TCP (needs to be
     //    given to underlying datagram socket)
 
+    // rule 0: apply cork()/uncork() requests from the owner
+    // (before rule 2, so that a request takes effect before data written after it)
+    _eventloop.add_rule(_control.second,
+                        Direction::In,
+                        [&] {
+                            for (const char request : _control.second.read(64)) {
+                                if (request == CONTROL_CORK) {
+                                    _tcp->cork();
+                                } else if (request == CONTROL_UNCORK) {
+                                    _tcp->uncork();
+                                }
+                            }
+                        },
+                        [&] { return _tcp->active(); });
+
     // rule 1: read from filtered packet stream and dump into TCPConnection
+    // (every datagram that is ready goes in as one batch, answered by one ACK; with receive
+    // coalescing, in-order runs of the batch are merged first)
     _eventloop.add_rule(_datagram_adapter,
                         Direction::In,
                         [&] {
-                            auto seg = _datagram_adapter.read();
-                            if (seg) {
-                                _tcp->segment_received(move(seg.value()));
+                            // the adapter is non-blocking: a read that finds nothing (EAGAIN) ends the batch
+                            const FileDescriptor &datagram_fd = _datagram_adapter;
+                            vector<TCPSegment> batch;
+                            while (batch.size() < RECEIVE_MAX_BATCH) {
+                                const auto reads = datagram_fd.read_count();
+                                auto seg = _datagram_adapter.read();
+                                if (datagram_fd.read_count() == reads) {
+                                    break;
+                                }
+                                if (seg) {
+                                    batch.push_back(move(seg.value()));
+                                }
+                            }
+                            if (_gro) {
+                                batch = TCPSegment::coalesce(move(batch));
                             }
+                            _tcp->segments_received(batch);
 
                             // debugging output:
                             if (_thread_data.eof() and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
@@ -96,9 +146,9 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
         _thread_data,
         Direction::In,
         [&] {
-            const auto data = _thread_data.read(_tcp->remaining_outbound_capacity());
+            auto data = _thread_data.read(_tcp->remaining_outbound_capacity());
             const auto len = data.size();
-            const auto amount_written = _tcp->write(move(data));
+            const auto amount_written = _tcp->write(Buffer(move(data)));
             if (amount_written != len) {
                 throw runtime_error("TCPConnection::write() accepted less than advertised length");
             }
@@ -128,10 +178,11 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
             // Write from the inbound_stream into
             // the pipe, handling the possibility of a partial
             // write (i.e., only pop what was actually written).
-            const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
-            const std::string buffer = inbound.peek_output(amount_to_write);
-            const auto bytes_written = _thread_data.write(move(buffer), false);
-            inbound.pop_output(bytes_written);
+            // The bytes go straight from the stream's ring to the
+            // pipe, without being copied into a temporary string.
+            const auto spans = inbound.readable_spans(65536);
+            const auto bytes_written = _thread_data.write(spans[0], false);
+            inbound.consume(bytes_written);
 
             if (inbound.eof() or inbound.error()) {
                 _thread_data.shutdown(SHUT_WR);
@@ -174,7 +225,17 @@ static inline pair<FileDescriptor, FileDescriptor> socket_pair_helper(const int
 //! \param[in] datagram_interface is the underlying interface (e.g. to UDP, IP, or Ethernet)
 template <typename AdaptT>
 TCPSpongeSocket<AdaptT>::TCPSpongeSocket(AdaptT &&datagram_interface)
-    : TCPSpongeSocket(socket_pair_helper(SOCK_STREAM), move(datagram_interface)) {}
+    : TCPSpongeSocket(socket_pair_helper(SOCK_STREAM), socket_pair_helper(SOCK_STREAM), move(datagram_interface)) {}
+
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::cork() {
+    _control.first.write(string(1, CONTROL_CORK));
+}
+
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::uncork() {
+    _control.first.write(string(1, CONTROL_UNCORK));
+}
 
 template <typename AdaptT>
 TCPSpongeSocket<AdaptT>::~TCPSpongeSocket() {
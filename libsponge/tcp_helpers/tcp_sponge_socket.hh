@@ -23,6 +23,9 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! Stream socket for reads and writes between owner and TCP thread
     LocalStreamSocket _thread_data;
 
+    //! Stream socket carrying cork()/uncork() requests from the owner (first) to the TCP thread (second)
+    std::pair<LocalStreamSocket, LocalStreamSocket> _control;
+
   protected:
     //! Adapter to underlying datagram socket (e.g., UDP or IP)
     AdaptT _datagram_adapter;
@@ -46,8 +49,10 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! Handle to the TCPConnection thread; owner thread calls join() in the destructor
     std::thread _tcp_thread{};
 
-    //! Construct LocalStreamSocket fds from socket pair, initialize eventloop
-    TCPSpongeSocket(std::pair<FileDescriptor, FileDescriptor> data_socket_pair, AdaptT &&datagram_interface);
+    //! Construct LocalStreamSocket fds from socket pairs, initialize eventloop
+    TCPSpongeSocket(std::pair<FileDescriptor, FileDescriptor> data_socket_pair,
+                    std::pair<FileDescriptor, FileDescriptor> control_socket_pair,
+                    AdaptT &&datagram_interface);
 
     std::atomic_bool _abort{false};  //!< Flag used by the owner to force the TCPConnection thread to shut down
 
@@ -57,6 +62,8 @@ class TCPSpongeSocket : public LocalStreamSocket {
 
     bool _fully_acked{false};  //!< Has the outbound data been fully acknowledged by the peer?
 
+    bool _gro{false};  //!< Coalesce the segments that arrive together before handing them to the TCPConnection?
+
   public:
     //! Construct from the interface that the TCPConnection thread will use to read and write datagrams
     explicit TCPSpongeSocket(AdaptT &&datagram_interface);
@@ -72,6 +79,13 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! Listen and accept using the specified configurations; blocks until accept succeeds or fails
     void listen_and_accept(const TCPConfig &c_tcp, const FdAdapterConfig &c_ad);
 
+    //! \brief Batch small writes: the TCPConnection holds back segments smaller than the MSS until uncork()
+    //! \note Like [TCP_CORK](\ref man7::tcp); takes effect before any data written after this call is sent
+    void cork();
+
+    //! \brief Send the data held back since cork() right away
+    void uncork();
+
     //! When a connected socket is destructed, it will send a RST
     ~TCPSpongeSocket();
 
@@ -117,7 +131,7 @@ using LossyTCPOverIPv4SpongeSocket = TCPSpongeSocket<LossyTCPOverIPv4OverTunFdAd
 //!
 //! There are a few notable differences between the TCPSpongeSocket and TCPSocket interfaces:
 //!
-//! - a TCPSpongeSocket can only accept a single connection
+//! - a TCPSpongeSocket can only accept a single connection (a TCPDemuxLoop serves many from one thread)
 //! - listen_and_accept() is a blocking function call that acts as both [listen(2)](\ref man2::listen)
 //!   and [accept(2)](\ref man2::accept)
 //! - if TCPSpongeSocket is destructed while a TCP connection is open, the connection is
@@ -1,5 +1,7 @@
 #include "tcp_state.hh"
 
+#include <stdexcept>
+
 using namespace std;
 
 bool TCPState::operator==(const TCPState &other) const {
@@ -80,31 +82,33 @@ TCPState::TCPState(const TCPSender &sender, const TCPReceiver &receiver, const b
     , _linger_after_streams_finish(active ? linger : false) {}
 
 string TCPState::state_summary(const TCPReceiver &receiver) {
-    if (receiver.stream_out().error()) {
-        return TCPReceiverStateSummary::ERROR;
-    } else if (not receiver.ackno().has_value()) {
-        return TCPReceiverStateSummary::LISTEN;
-    } else if (receiver.stream_out().input_ended()) {
-        return TCPReceiverStateSummary::FIN_RECV;
-    } else {
-        return TCPReceiverStateSummary::SYN_RECV;
+    switch (receiver.state()) {
+        case TCPReceiverState::ERROR:
+            return TCPReceiverStateSummary::ERROR;
+        case TCPReceiverState::LISTEN:
+            return TCPReceiverStateSummary::LISTEN;
+        case TCPReceiverState::SYN_RECV:
+            return TCPReceiverStateSummary::SYN_RECV;
+        case TCPReceiverState::FIN_RECV:
+            return TCPReceiverStateSummary::FIN_RECV;
     }
+    throw runtime_error("unknown TCPReceiverState");
 }
 
 string TCPState::state_summary(const TCPSender &sender) {
-    if (sender.stream_in().error()) {
-        return TCPSenderStateSummary::ERROR;
-    } else if (sender.next_seqno_absolute() == 0) {
-        return TCPSenderStateSummary::CLOSED;
-    } else if (sender.next_seqno_absolute() == sender.bytes_in_flight()) {
-        return TCPSenderStateSummary::SYN_SENT;
-    } else if (not sender.stream_in().eof()) {
-        return TCPSenderStateSummary::SYN_ACKED;
-    } else if (sender.next_seqno_absolute() < sender.stream_in().bytes_written() + 2) {
-        return TCPSenderStateSummary::SYN_ACKED;
-    } else if (sender.bytes_in_flight()) {
-        return TCPSenderStateSummary::FIN_SENT;
-    } else {
-        return TCPSenderStateSummary::FIN_ACKED;
+    switch (sender.state()) {
+        case TCPSenderState::ERROR:
+            return TCPSenderStateSummary::ERROR;
+        case TCPSenderState::CLOSED:
+            return TCPSenderStateSummary::CLOSED;
+        case TCPSenderState::SYN_SENT:
+            return TCPSenderStateSummary::SYN_SENT;
+        case TCPSenderState::SYN_ACKED:
+            return TCPSenderStateSummary::SYN_ACKED;
+        case TCPSenderState::FIN_SENT:
+            return TCPSenderStateSummary::FIN_SENT;
+        case TCPSenderState::FIN_ACKED:
+            return TCPSenderStateSummary::FIN_ACKED;
     }
+    throw runtime_error("unknown TCPSenderState");
 }
@@ -57,9 +57,11 @@ class TCPState {
     TCPState(const TCPState::State state);
 
     //! \brief Summarize the state of a TCPReceiver in a string
+    //! \note For tests and debugging output; the TCP code itself uses TCPReceiver::state()
     static std::string state_summary(const TCPReceiver &receiver);
 
     //! \brief Summarize the state of a TCPSender in a string
+    //! \note For tests and debugging output; the TCP code itself uses TCPSender::state()
     static std::string state_summary(const TCPSender &receiver);
 };
 
@@ -42,9 +42,15 @@ void TCPOverIPv4OverEthernetAdapter::tick(const size_t ms_since_last_tick) {
     send_pending();
 }
 
-//! \param[in] seg the TCPSegment to send
+//! \param[in] seg the TCPSegment to send (a GSO super-segment is sent as one frame per wire-sized piece)
 void TCPOverIPv4OverEthernetAdapter::write(TCPSegment &seg) {
-    _interface.send_datagram(wrap_tcp_in_ip(seg), _next_hop);
+    if (seg.gso_size() == 0) {
+        _interface.send_datagram(wrap_tcp_in_ip(seg), _next_hop);
+    } else {
+        for (auto &piece : seg.gso_split()) {
+            _interface.send_datagram(wrap_tcp_in_ip(piece), _next_hop);
+        }
+    }
     send_pending();
 }
 
@@ -28,7 +28,36 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
     }
 
     //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
-    void write(TCPSegment &seg) { _tun.write(wrap_tcp_in_ip(seg).serialize()); }
+    //! \note A GSO super-segment becomes one datagram per wire-sized piece, each written with one writev()
+    void write(TCPSegment &seg) {
+        if (seg.gso_size() == 0) {
+            _tun.write(wrap_tcp_in_ip(seg).serialize());
+            return;
+        }
+        for (auto &piece : seg.gso_split()) {
+            _tun.write(wrap_tcp_in_ip(piece).serialize());
+        }
+    }
+
+    //! Attempts to read and parse an IPv4 datagram containing a TCP segment of any connection (for TCPDemux)
+    std::optional<std::pair<FourTuple, TCPSegment>> read_flow() {
+        InternetDatagram ip_dgram;
+        if (ip_dgram.parse(_tun.read()) != ParseResult::NoError) {
+            return {};
+        }
+        return unwrap_tcp_flow(ip_dgram);
+    }
+
+    //! Creates an IPv4 datagram from a TCP segment of connection `flow` and writes it to the TUN device
+    void write_flow(const FourTuple &flow, TCPSegment &seg) {
+        if (seg.gso_size() == 0) {
+            _tun.write(wrap_tcp_in_ip(flow, seg).serialize());
+            return;
+        }
+        for (auto &piece : seg.gso_split()) {
+            _tun.write(wrap_tcp_in_ip(flow, piece).serialize());
+        }
+    }
 
     //! Access the underlying TUN device
     operator TunFD &() { return _tun; }
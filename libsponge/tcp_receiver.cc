@@ -1,5 +1,7 @@
 #include "tcp_receiver.hh"
 
+#include <limits>
+
 // Dummy implementation of a TCP receiver
 
 // For Lab 2, please replace with a real implementation that passes the
@@ -16,7 +18,7 @@ using namespace std;
 // FIN_RECV  FIN 到达, 通过字节流是否关闭来判断
 
 // 处理接收到的 TCP segment
-void TCPReceiver::segment_received(const TCPSegment &seg) {
+bool TCPReceiver::segment_received(const TCPSegment &seg) {
     // DUMMY_CODE(seg);
     const TCPHeader &header = seg.header();
     const bool syn = header.syn;  // 标记 TCP报文头 syn
@@ -26,26 +28,66 @@ void TCPReceiver::segment_received(const TCPSegment &seg) {
     if (!_set_syn) {
         // 当前 segment syn 为 false
         if (!syn) {
-            return;
+            return true;
         }
         // 当前 segment syn 为 true 收到 SYN 转为 SYN_RECV 状态
         _set_syn = true;
         _isn = header.seqno;
     }
 
+    // PAWS: 时间戳比 TS.Recent 旧 (按 32 位回绕比较) 的是早先留在网络中的重复 segment, 丢弃
+    // 没有协商时间戳时对端带来的选项一律忽略
+    const bool use_timestamps = _timestamps && header.timestamps.has_value();
+    if (use_timestamps && _ts_recent.has_value() &&
+        static_cast<int32_t>(header.timestamps->tsval - _ts_recent.value()) < 0) {
+        return false;
+    }
+
     // 用 unassembled_index 来作为 checkpoint
     auto checkpoint = _reassembler.stream_out().bytes_written() + 1;
     // unwrap 后得到 64bit abs_seqno
     uint64_t abs_seqno = unwrap(header.seqno, _isn, checkpoint);
 
+    // 只有通过可接受性检查 (落在接收窗口内) 且从上次 ACK 的位置开始 (或更早) 的 segment 才更新 TS.Recent
+    // (RFC 7323 第 4.3 节), 窗口外的 segment 不能把它推进
+    if (use_timestamps && (syn || acceptable(abs_seqno, seg.length_in_sequence_space())) &&
+        (!_last_ack_sent.has_value() || header.seqno - _last_ack_sent.value() <= 0)) {
+        _ts_recent = header.timestamps->tsval;
+    }
+
     // 从 abs_seqno 得到有效字节流序号, 非 syn segment 去掉 syn 的占位
     uint64_t stream_index = abs_seqno + (syn ? 0 : -1);
-    _reassembler.push_substring(seg.payload().copy(), stream_index, fin);
+    if (stream_index > _reassembler.stream_out().bytes_written()) {
+        _recent_out_of_order_index = stream_index;
+    }
+    // payload 是数据报 Buffer 的切片, 直接交给 reassembler, 不再拷贝出一个 string
+    // 接收合并 (GRO) 得到的 segment 把后面的 payload 挂在 frags 上, 依次交给 reassembler, FIN 跟着最后一片
+    const auto &frags = seg.frags();
+    _reassembler.push_substring(seg.payload(), stream_index, fin && frags.empty());
+    stream_index += seg.payload().size();
+    for (size_t i = 0; i < frags.size(); i++) {
+        _reassembler.push_substring(frags[i], stream_index, fin && i + 1 == frags.size());
+        stream_index += frags[i].size();
+    }
 
     // FIN_RECV 状态
     if (fin) {
         _set_fin = true;
     }
+    // FIN 之前的数据全部组装好, 字节流才结束
+    _state = _reassembler.stream_out().input_ended() ? TCPReceiverState::FIN_RECV : TCPReceiverState::SYN_RECV;
+    return true;
+}
+
+// RFC 793 的可接受性检查: 有长度的 segment 与窗口有重叠, 空 segment 落在窗口内 (窗口为 0 时正好在 ackno 上)
+bool TCPReceiver::acceptable(const uint64_t abs_seqno, const size_t length) const {
+    const uint64_t window_start =
+        _reassembler.stream_out().bytes_written() + 1 + (_reassembler.stream_out().input_ended() ? 1 : 0);
+    const uint64_t window_end = window_start + window_size();
+    if (length == 0) {
+        return abs_seqno == window_start || (abs_seqno > window_start && abs_seqno < window_end);
+    }
+    return abs_seqno < window_end && abs_seqno + length > window_start;
 }
 
 optional<WrappingInt32> TCPReceiver::ackno() const {
@@ -64,4 +106,55 @@ optional<WrappingInt32> TCPReceiver::ackno() const {
     }
 }
 
-size_t TCPReceiver::window_size() const { return _capacity - _reassembler.stream_out().buffer_size(); }
+void TCPReceiver::grow_capacity(const size_t capacity) {
+    _reassembler.grow_capacity(capacity);
+    _capacity = max(_capacity, capacity);
+}
+
+// 冻结时窗口右沿停在 hold_window 时的位置, 收到的数据只会让窗口缩小, 应用读走数据也不再打开窗口
+void TCPReceiver::hold_window(const bool hold) {
+    if (hold && !_window_held) {
+        _held_window_edge = stream_out().bytes_read() + _capacity;
+    }
+    _window_held = hold;
+}
+
+size_t TCPReceiver::window_size() const {
+    const size_t window = _capacity - _reassembler.stream_out().buffer_size();
+    if (!_window_held) {
+        return window;
+    }
+    const uint64_t written = _reassembler.stream_out().bytes_written();
+    return min(window, static_cast<size_t>(_held_window_edge > written ? _held_window_edge - written : 0));
+}
+
+uint16_t TCPReceiver::window_advertisement(const uint8_t shift) const {
+    return min(window_size() >> shift, size_t{numeric_limits<uint16_t>::max()});
+}
+
+vector<SACKBlock> TCPReceiver::sack_blocks(const size_t max_blocks) const {
+    vector<SACKBlock> blocks;
+    const auto &intervals = _reassembler.unassembled_intervals();
+    if (!_set_syn || intervals.empty() || max_blocks == 0) {
+        return blocks;
+    }
+    // stream index 加上 SYN 占的一个序号即为 abs seqno
+    const auto to_block = [&](const pair<const size_t, size_t> &interval) {
+        return SACKBlock{wrap(interval.first + 1, _isn), wrap(interval.second + 1, _isn)};
+    };
+
+    // 第一个 block 是包含最近乱序到达的 segment 的区间 (RFC 2018 第 4 节)
+    auto recent = intervals.upper_bound(_recent_out_of_order_index);
+    if (recent != intervals.begin() && prev(recent)->second > _recent_out_of_order_index) {
+        recent = prev(recent);
+        blocks.push_back(to_block(*recent));
+    } else {
+        recent = intervals.end();
+    }
+    for (auto it = intervals.begin(); it != intervals.end() && blocks.size() < max_blocks; ++it) {
+        if (it != recent) {
+            blocks.push_back(to_block(*it));
+        }
+    }
+    return blocks;
+}
@@ -7,6 +7,15 @@
 #include "wrapping_integers.hh"
 
 #include <optional>
+#include <vector>
+
+//! \brief Where a TCPReceiver is in its stream (TCPState::state_summary() describes each in words)
+enum class TCPReceiverState {
+    ERROR,     //!< the connection was reset
+    LISTEN,    //!< waiting for SYN
+    SYN_RECV,  //!< SYN received, stream ongoing
+    FIN_RECV,  //!< the whole stream, up to FIN, has been received
+};
 
 //! \brief The "receiver" part of a TCP implementation.
 
@@ -25,6 +34,21 @@ class TCPReceiver {
     bool _set_fin = false;
     // isn seqno 初始化
     WrappingInt32 _isn = WrappingInt32(0);
+    // 最近一个乱序到达的 segment 的 stream index, SACK 的第一个 block 要包含它
+    uint64_t _recent_out_of_order_index = 0;
+    // 时间戳 (RFC 7323): TS.Recent 是对端最近一个可以回显的 TSval, 以及最近发出的 ACK 的 ackno (Last.ACK.sent)
+    // 只有双方的 SYN 都带了 timestamps 选项才检查 PAWS 和记录 TS.Recent, 否则忽略收到的选项 (RFC 7323 第 3.2 节)
+    bool _timestamps{false};
+    std::optional<uint32_t> _ts_recent{};
+    std::optional<WrappingInt32> _last_ack_sent{};
+    // 收到 SYN 以及 FIN 之前的数据全部组装好时更新, ERROR 由 state() 查看字节流得到
+    TCPReceiverState _state{TCPReceiverState::LISTEN};
+    // 内存紧张时窗口右沿不再前移: 冻结的右沿 (stream index)
+    bool _window_held{false};
+    uint64_t _held_window_edge{0};
+
+    // RFC 793 的可接受性检查: 从 abs_seqno 开始, 占 length 个序号的 segment 是否落在接收窗口内
+    bool acceptable(const uint64_t abs_seqno, const size_t length) const;
 
   public:
     //! \brief Construct a TCP receiver
@@ -55,13 +79,70 @@ class TCPReceiver {
     //! accepted by the receiver) and (b) the sequence number of the
     //! beginning of the window (the ackno).
     size_t window_size() const;
+
+    //! \brief The value for the header's 16-bit window field
+    //! \param shift the negotiated [window scale](\ref rfc::rfc7323) (0 if none, and always 0 in a SYN)
+    //! \returns window_size() shifted right by `shift` (rounding down), saturating at 65535
+    uint16_t window_advertisement(const uint8_t shift) const;
+
+    //! \brief [SACK](\ref rfc::rfc2018) blocks describing the out-of-order data being held
+    //! \param max_blocks the most blocks that fit in the segment's option space
+    //! \returns the block holding the most recently received out-of-order segment first, then the rest
+    //! in sequence order; empty if nothing is held out of order
+    std::vector<SACKBlock> sack_blocks(const size_t max_blocks) const;
+
+    //! \brief The [timestamp](\ref rfc::rfc7323) to echo to the peer (TS.Recent), 0 before any was received
+    uint32_t ts_recent() const { return _ts_recent.value_or(0); }
     //!@}
 
+    //! \brief Whether timestamps were negotiated: only then are received timestamps remembered and checked
+    //! by PAWS; otherwise the option is ignored
+    void set_timestamps(const bool negotiated) { _timestamps = negotiated; }
+
+    //! \brief An ACK carrying `ackno` was sent: segments that start at or before it may update ts_recent()
+    //! \note This keeps the echoed timestamp that of the earliest segment a delayed ACK acknowledges
+    void ack_sent(const WrappingInt32 ackno) { _last_ack_sent = ackno; }
+
+    //! \brief Where the receiver is in its stream, kept up to date as segments arrive
+    TCPReceiverState state() const { return stream_out().error() ? TCPReceiverState::ERROR : _state; }
+
     //! \brief number of bytes stored but not yet reassembled
     size_t unassembled_bytes() const { return _reassembler.unassembled_bytes(); }
 
+    //! \brief number of payloads that arrived in order and skipped reassembly (see StreamReassembler)
+    size_t fast_path_pushes() const { return _reassembler.fast_path_pushes(); }
+
+    //! \brief number of payloads that needed reassembly (see StreamReassembler)
+    size_t slow_path_pushes() const { return _reassembler.slow_path_pushes(); }
+
+    //! \name Buffer sizing
+    //!@{
+
+    //! \brief The most bytes the receiver will store at once (what window_size() counts down from)
+    size_t capacity() const { return _capacity; }
+
+    //! \brief Raise the capacity to `capacity`; a smaller value is ignored, so the window never retreats
+    void grow_capacity(const size_t capacity);
+
+    //! \brief Free the receive buffers while they hold nothing (they are allocated again when data arrives)
+    void release_memory() { _reassembler.release_memory(); }
+
+    //! \returns the bytes of memory held by the receive buffers
+    size_t memory_usage() const { return _reassembler.memory_usage(); }
+
+    //! \brief While `hold` is true, keep the right edge of the window where it is now, e.g. under memory
+    //! pressure: the window shrinks as data arrives, and reading the stream does not open it again
+    void hold_window(const bool hold);
+
+    //! \brief While `shed` is true, drop data that arrives out of order (see StreamReassembler::shed_out_of_order())
+    void shed_out_of_order(const bool shed) { _reassembler.shed_out_of_order(shed); }
+    //!@}
+
     //! \brief handle an inbound segment
-    void segment_received(const TCPSegment &seg);
+    //! \returns false if PAWS ([RFC 7323](\ref rfc::rfc7323)) rejected it as an old duplicate: timestamps
+    //! were negotiated and its timestamp is older than ts_recent(), so it was ignored, and should be answered
+    //! with an ACK
+    bool segment_received(const TCPSegment &seg);
 
     //! \name "Output" interface for the reader
     //!@{
@@ -1,6 +1,7 @@
 #include "tcp_config.hh"
 #include "tcp_sender.hh"
 
+#include <limits>
 #include <random>
 
 // Dummy implementation of a TCP sender
@@ -17,10 +18,101 @@ using namespace std;
 //! \param[in] retx_timeout the initial amount of time to wait before retransmitting the oldest outstanding segment
 //! \param[in] fixed_isn the Initial Sequence Number to use, if set (otherwise uses a random ISN)
 TCPSender::TCPSender(const size_t capacity, const uint16_t retx_timeout, const std::optional<WrappingInt32> fixed_isn)
-    : _isn(fixed_isn.value_or(WrappingInt32{random_device()()}))
-    , _initial_retransmission_timeout{retx_timeout}
-    , _stream(capacity)
-    , _timer(retx_timeout) {}
+    : TCPSender([&] {
+        TCPConfig config;
+        config.send_capacity = capacity;
+        config.rt_timeout = retx_timeout;
+        config.fixed_isn = fixed_isn;
+        return config;
+    }()) {}
+
+//! \param[in] config the connection's configuration; the sender uses the send capacity,
+//! retransmission timeout, ISN and maximum payload size
+TCPSender::TCPSender(const TCPConfig &config)
+    : _isn(config.fixed_isn.value_or(WrappingInt32{random_device()()}))
+    , _initial_retransmission_timeout{config.rt_timeout}
+    , _stream(config.send_capacity, ByteStream::Storage::Chunked)
+    , _timer(config.rt_timeout, config.adaptive_rto ? config.max_rto : numeric_limits<uint64_t>::max())
+    , _max_payload_size(min(config.max_payload_size, TCPConfig::MAX_JUMBO_PAYLOAD_SIZE))
+    , _send_mss(_max_payload_size)
+    , _congestion_control(CongestionControl::make(config.congestion_control, _send_mss))
+    , _adaptive_rto(config.adaptive_rto)
+    , _rtt_estimator(config.min_rto, config.max_rto)
+    , _fast_retransmit(config.fast_retransmit || config.sack)
+    , _sack_permitted(config.sack)
+    , _window_scaling(config.window_scaling)
+    , _recv_window_shift([&] {
+        // 最小的移位数, 使整个接收缓冲区 (自动调整时按它能增长到的大小) 都能用 16 位的窗口字段表示
+        const size_t capacity = max(config.recv_capacity, config.buffer_autotuning ? config.recv_capacity_max : 0);
+        uint8_t shift = 0;
+        while (shift < TCPHeader::MAX_WINDOW_SHIFT && (capacity >> shift) > numeric_limits<uint16_t>::max()) {
+            shift++;
+        }
+        return shift;
+    }())
+    , _timestamps(config.timestamps)
+    , _nagle(config.nagle)
+    , _pacing(config.pacing)
+    , _gso(config.gso) {}
+
+// 对端没有通告 MSS 时继续使用本端配置的值 (而不是 RFC 879 的默认值 536)
+void TCPSender::set_peer_mss(const uint16_t peer_mss) {
+    if (peer_mss > 0) {
+        _send_mss = min(_max_payload_size, size_t{peer_mss});
+        _congestion_control->set_mss(_send_mss);
+    }
+}
+
+// 在对端的 SYN 到达之前不知道是否启用, 所以本端的 SYN 总是带上选项 (如果配置了), 对端的 SYN 没带则放弃
+void TCPSender::set_peer_window_scale(const optional<uint8_t> peer_shift) {
+    _window_scaling = _window_scaling && peer_shift.has_value();
+    if (_window_scaling) {
+        _send_window_shift = min(peer_shift.value(), TCPHeader::MAX_WINDOW_SHIFT);
+    }
+}
+
+void InFlightRing::push_back(Entry entry) {
+    if (_size == _entries.size()) {
+        // 满了则容量翻倍, 按顺序搬到新数组的开头
+        vector<Entry> entries(2 * _entries.size());
+        for (size_t i = 0; i < _size; i++) {
+            entries[i] = std::move(_entries[(_head + i) & (_entries.size() - 1)]);
+        }
+        _entries = std::move(entries);
+        _head = 0;
+    }
+    _charge.set(_charge.bytes() + entry.payload.size());
+    _entries[(_head + _size) & (_entries.size() - 1)] = std::move(entry);
+    _size++;
+}
+
+uint64_t InFlightRing::pop_acked(const uint64_t ackno) {
+    if (empty() || front().end() > ackno) {
+        return 0;
+    }
+    // entry 按序号连续排列, end() 单调递增
+    size_t lo = 1, hi = _size;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if ((*this)[mid].end() <= ackno) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    const uint64_t acked = (*this)[lo - 1].end() - front().seqno;
+    // 释放弹出 entry 对 payload 的引用
+    size_t released = 0;
+    for (size_t i = 0; i < lo; i++) {
+        Buffer &payload = _entries[(_head + i) & (_entries.size() - 1)].payload;
+        released += payload.size();
+        payload = Buffer{};
+    }
+    _charge.set(_charge.bytes() - released);
+    _head = (_head + lo) & (_entries.size() - 1);
+    _size -= lo;
+    return acked;
+}
 
 uint64_t TCPSender::bytes_in_flight() const { return _bytes_in_flight; }
 
@@ -45,12 +137,13 @@ void TCPSender::fill_window() {
             }
         }
     } else {
+        const uint64_t send_window = min(_window_size, uint64_t{congestion_window()});
         while (true) {
             TCPSegment segment;
-            if (_window_size > bytes_in_flight()) {
-                fill_window_size = _window_size - bytes_in_flight();
+            if (send_window > bytes_in_flight()) {
+                fill_window_size = send_window - bytes_in_flight();
             }
-            // _window_size <= bytes_in_flight() 不需要填充窗口, 被 unack 的 TCP segmengt 占满了
+            // send_window <= bytes_in_flight() 不需要填充窗口, 被 unack 的 TCP segmengt 占满了
             else {
                 fill_window_size = 0;
             }
@@ -63,7 +156,7 @@ void TCPSender::fill_window() {
 
 bool TCPSender::push_segment(TCPSegment &segment, size_t &length) {
     if (!_set_syn) {
-        segment.header().syn = true;
+        set_syn_options(segment.header());
         _set_syn = true;
     }
 
@@ -72,10 +165,22 @@ bool TCPSender::push_segment(TCPSegment &segment, size_t &length) {
     }
 
     // payload 不包括 SYN 和 FIN, 但是 window_size 包括 SYN 和 FIN
-    size_t payload_size = min(TCPConfig::MAX_PAYLOAD_SIZE, min(length - segment.header().syn, _stream.buffer_size()));
+    size_t payload_size = min(max_segment_payload(), min(length - segment.header().syn, _stream.buffer_size()));
+    if (hold_partial_segment(payload_size)) {
+        return false;
+    }
+    // 令牌用完, 等 tick 补充后再发
+    if (pacing_active() && _pacing_tokens <= 0) {
+        return false;
+    }
 
-    auto payload = _stream.read(payload_size);
-    segment.payload() = Buffer(std::move(payload));
+    // 发送端字节流按 Buffer 切片保存, payload 直接引用应用写入的 Buffer
+    // 只有跨越两次写入的 segment 才需要拼接拷贝
+    const BufferList payload = _stream.read_buffers(payload_size);
+    segment.payload() = payload.buffers().size() <= 1 ? Buffer(payload) : Buffer(payload.concatenate());
+    if (payload_size > _send_mss) {
+        segment.gso_size() = _send_mss;
+    }
 
     // 设置fin 要求之前没有置位 FIN, 且读到 eof, 且 发送窗口还有空间
     if (!_set_fin && _stream.eof() && segment.length_in_sequence_space() < length) {
@@ -93,21 +198,39 @@ bool TCPSender::push_segment(TCPSegment &segment, size_t &length) {
     // 将 TCP segment 放到 _segments_out 队列中发送
     // 发送即若定时器启动定时器
     segment.header().seqno = next_seqno();
-    _segments_out.push(segment);
+    // 重传队列只保存 payload 的引用, segment 本身移入 _segments_out
+    const TCPHeader &header = segment.header();
+    _in_flight.push_back({_next_seqno, segment_lenth, header.syn, header.fin, segment.payload()});
+    _segments_out.push(std::move(segment));
     if (!_timer.check_running())
         _timer.start();
+    if (!_rtt_timing) {
+        _rtt_timing = true;
+        _rtt_seqno_end = _next_seqno + segment_lenth;
+        _rtt_sent_at = _time_ms;
+    }
 
-    // unack队列保留未确认的 TCP segment
-    // 更新下一个序列号_next_seqno和发出但未 ACK 的字节数即_segmengts_unack队列
-    _segments_unackno.emplace(std::move(segment));
+    // 更新下一个序列号_next_seqno和发出但未 ACK 的字节数
     _next_seqno += segment_lenth;
     _bytes_in_flight += segment_lenth;
+    update_state();
+    if (pacing_active()) {
+        _pacing_tokens -= segment_lenth;
+    }
     return true;
 }
 
 //! \param ackno The remote receiver's ackno (acknowledgment number)
 //! \param window_size The remote receiver's advertised window size
-void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_size) {
+//! \param carries_data whether the segment carrying the ACK also occupied sequence space
+//! (such an ACK is never counted as a duplicate)
+//! \param sack the SACK blocks carried by the ACK (ignored unless SACK was negotiated)
+//! \param tsecr the timestamp echoed by the ACK (ignored unless timestamps were negotiated)
+void TCPSender::ack_received(const WrappingInt32 ackno,
+                             const uint64_t window_size,
+                             const bool carries_data,
+                             const vector<SACKBlock> &sack,
+                             const optional<uint32_t> tsecr) {
     // 使用 _recv_ackno 作为 checkpoint
     // _recv_ackno 表示下一个期待发送方发送的 seqno
     uint64_t abs_ackno = unwrap(ackno, _isn, _recv_ackno);
@@ -116,34 +239,78 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
     if (abs_ackno > _next_seqno || abs_ackno < _recv_ackno) {
         return;
     }
-    // _recv_ackno 确认到 abs_ackno
-    _recv_ackno = abs_ackno;
 
-    bool ack_update_flag = false;
+    const uint64_t sacked_before = _sacked_bytes;
+    if (_sack_permitted) {
+        update_scoreboard(sack, abs_ackno);
+    }
 
-    // 检查 ack 是否确认了 outstanding 中新的 TCPsegment
-    while (!_segments_unackno.empty()) {
-        auto segment = _segments_unackno.front();
-        uint64_t segment_abs_seqno = unwrap(segment.header().seqno, _isn, _next_seqno);
-        uint64_t segment_lenth = segment.length_in_sequence_space();
+    // 重复 ACK (RFC 5681): 没有确认新数据, 不携带数据, 窗口不变, 且还有未确认的数据
+    // 使用 SACK 时, SACK 了新数据的 ACK 即使窗口变了也算重复 ACK (RFC 6675 第 2 节)
+    const bool same_window = window_size == _window_size || _sacked_bytes > sacked_before;
+    if (_fast_retransmit && abs_ackno == _recv_ackno && !carries_data && same_window && bytes_in_flight() > 0) {
+        duplicate_ack_received();
+        _window_size = window_size;
+        fill_window();
+        return;
+    }
 
-        if (segment_abs_seqno + segment_lenth <= _recv_ackno) {
-            ack_update_flag = true;
-            _segments_unackno.pop();
-            _bytes_in_flight -= segment_lenth;
-        } else {
-            break;
+    const uint64_t acked_bytes = abs_ackno - _recv_ackno;
+    // 新确认的字节数和 RTT 样本交给拥塞控制
+    if (acked_bytes > 0) {
+        _duplicate_acks_cnt = 0;
+        // 回显的时间戳不会比现在的时钟还新, 否则是对端的错误, 不采样
+        const int32_t echoed_rtt = tsecr.has_value() ? static_cast<int32_t>(timestamp_clock() - tsecr.value()) : -1;
+        if (_timestamps && echoed_rtt >= 0) {
+            add_rtt_sample(echoed_rtt);
+        } else if (_rtt_timing && abs_ackno >= _rtt_seqno_end) {
+            _rtt_timing = false;
+            add_rtt_sample(_time_ms - _rtt_sent_at);
+        }
+        // 快速恢复期间窗口不增长
+        if (!_in_fast_recovery) {
+            _congestion_control->on_ack(acked_bytes, _time_ms);
         }
     }
 
-    // ack 如果更新了, 定时器以及选择重传数进行重置
-    if (ack_update_flag) {
+    // _recv_ackno 确认到 abs_ackno
+    _recv_ackno = abs_ackno;
+
+    // 弹出 ack 完全确认的 outstanding segment, 部分确认的 segment 留在队首, 但已确认的部分不再算在途
+    _in_flight.pop_acked(_recv_ackno);
+    _bytes_in_flight = _next_seqno - _recv_ackno;
+    update_state();
+
+    // ack 确认了新数据, 定时器以及选择重传数进行重置 (RFC 6298 5.3)
+    if (acked_bytes > 0) {
         _consecutive_retransmissions_cnt = 0;
         _timer.reset();
         _timer.start();
     }
+    // NewReno 快速恢复 (RFC 6582): 确认到 _recover 为止的 full ACK 退出恢复,
+    // partial ACK 说明下一个空洞也丢了, 立即重传, 并把窗口膨胀收回已确认的部分
+    if (_in_fast_recovery && acked_bytes > 0) {
+        if (abs_ackno >= _recover) {
+            _in_fast_recovery = false;
+            _recovery_inflation = 0;
+            _retransmitted_high = 0;
+        } else {
+            _recovery_inflation -= min(_recovery_inflation, static_cast<size_t>(acked_bytes));
+            _recovery_inflation += _send_mss;
+            if (_sack_permitted) {
+                retransmit_sack_holes();
+            } else {
+                retransmit_first_unacked();
+            }
+        }
+    } else if (_sack_permitted && acked_bytes > 0 && abs_ackno < _recover) {
+        // 超时之前发出的数据可能丢了一长串, 之后每个确认了新数据的 ACK 都按记分板继续重传空洞,
+        // 而不是每次超时只修复一个 segment (RFC 6675 第 5.1 节)
+        retransmit_sack_holes();
+    }
+
     // ack 确认后如果 unack 队列为空让定时器暂停
-    if (_segments_unackno.empty()) {
+    if (_in_flight.empty()) {
         _timer.stop();
     }
     // 重新填充发送窗口
@@ -153,28 +320,291 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
 
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void TCPSender::tick(const size_t ms_since_last_tick) {
+    _time_ms += ms_since_last_tick;
     // 检查定时器是否启动
     if (_timer.check_running()) {
         _timer.tick(ms_since_last_tick);
     }
     // 定时器已经启动, 且定时器超时
     // 防御性编程, 检查是否为空
-    if (_timer.check_expired() && !_segments_unackno.empty()) {
+    if (_timer.check_expired() && !_in_flight.empty()) {
         // 重传最早未被确认的 TCP segment FIFO
-        _segments_out.push(_segments_unackno.front());
+        const InFlightRing::Entry &entry = _in_flight.front();
+        const uint64_t start = retransmit_start(entry);
+        _segments_out.push(in_flight_segment(entry, start, retransmit_end(entry, start, entry.end())));
 
         // 接收窗口的反馈为 0 时, 说明接收方没有能力接收, 但并不代表网络拥塞
         // 接收窗口大于 0, 定时器超时, 网络拥塞重传, 指数避退
         if (_window_size > 0) {
             _consecutive_retransmissions_cnt++;
             _timer.reset_double();
+            // 同一个 segment 的连续超时只让拥塞控制减小一次窗口 (RFC 5681 第 3.1 节)
+            if (_consecutive_retransmissions_cnt == 1) {
+                _congestion_control->on_timeout(bytes_in_flight());
+            }
         }
+        _rtt_timing = false;
+
+        // 超时后退出快速恢复, 已经发出的数据产生的重复 ACK 不再触发快速重传
+        _in_fast_recovery = false;
+        _recovery_inflation = 0;
+        _duplicate_acks_cnt = 0;
+        _recover = _next_seqno;
+        // 超时后不再相信 SACK 信息, 接收方可能已经丢弃了它们 (RFC 2018 第 8 节)
+        _sacked.clear();
+        _sacked_bytes = 0;
+        _retransmitted_high = 0;
+
         _timer.start();
     }
+
+    // 补充令牌, 桶的容量为两个 MSS 或这次 tick 补充的量, 取大者, 所以 tick 间隔越长允许的突发越大
+    if (pacing_active()) {
+        const int64_t refill = pacing_rate() * static_cast<int64_t>(ms_since_last_tick);
+        const int64_t burst = PACING_BURST_SEGMENTS * static_cast<int64_t>(_send_mss);
+        _pacing_tokens = min(_pacing_tokens + refill, max(burst, refill));
+        fill_window();
+    }
+}
+
+// 每毫秒允许发送的字节数: 发送窗口 / SRTT 乘以增益, 慢启动时加倍以免拖慢窗口增长
+int64_t TCPSender::pacing_rate() const {
+    const uint64_t window = min(_window_size, uint64_t{congestion_window()});
+    const bool slow_start = _congestion_control->cwnd() < _congestion_control->ssthresh();
+    const uint64_t gain = slow_start ? PACING_GAIN_SLOW_START : PACING_GAIN;
+    const uint64_t srtt = max(_rtt_estimator.srtt(), uint64_t{1});
+    return static_cast<int64_t>(max(window * gain / (100 * srtt), uint64_t{1}));
+}
+
+optional<uint64_t> TCPSender::pacing_delay() const {
+    const bool has_data = _stream.buffer_size() > 0 || (_stream.eof() && !_set_fin);
+    if (!pacing_active() || _pacing_tokens > 0 || !has_data) {
+        return nullopt;
+    }
+    const int64_t rate = pacing_rate();
+    return static_cast<uint64_t>((1 - _pacing_tokens + rate - 1) / rate);
+}
+
+optional<uint64_t> TCPSender::next_timeout() const {
+    optional<uint64_t> timeout = pacing_delay();
+    if (_timer.check_running() && !_in_flight.empty()) {
+        timeout = min(timeout.value_or(_timer.remaining()), _timer.remaining());
+    }
+    return timeout;
 }
 
 unsigned int TCPSender::consecutive_retransmissions() const { return _consecutive_retransmissions_cnt; }
 
+uint64_t TCPSender::send_window() const { return min(_window_size, uint64_t{congestion_window()}); }
+
+size_t TCPSender::congestion_window() const {
+    const size_t cwnd = _congestion_control->cwnd();
+    return cwnd > numeric_limits<size_t>::max() - _recovery_inflation ? numeric_limits<size_t>::max()
+                                                                      : cwnd + _recovery_inflation;
+}
+
+void TCPSender::duplicate_ack_received() {
+    _duplicate_acks_cnt++;
+    // 恢复期间每个重复 ACK 说明又有一个 segment 离开了网络, 窗口膨胀一个 MSS
+    if (_in_fast_recovery) {
+        _recovery_inflation += _send_mss;
+        if (_sack_permitted) {
+            retransmit_sack_holes();
+        }
+        return;
+    }
+    // 第三个重复 ACK 触发快速重传, 除非这些 ACK 还没有越过上一次恢复的 _recover (RFC 6582 3.2)
+    // 使用 SACK 时, 被 SACK 的字节超过 (DupThresh - 1) 个 MSS 也说明第一个未确认的 segment 丢了,
+    // 窗口很小凑不齐三个重复 ACK 时也能快速恢复 (RFC 6675 IsLost)
+    const bool lost = _duplicate_acks_cnt == DUPLICATE_ACK_THRESHOLD ||
+                      (_sack_permitted && _sacked_bytes > (DUPLICATE_ACK_THRESHOLD - 1) * _send_mss);
+    if (lost && _recv_ackno >= _recover) {
+        _in_fast_recovery = true;
+        _recover = _next_seqno;
+        _congestion_control->on_congestion_event(bytes_in_flight(), _time_ms);
+        _recovery_inflation = DUPLICATE_ACK_THRESHOLD * _send_mss;
+        _fast_retransmit_cnt++;
+        retransmit_first_unacked();
+        if (_sack_permitted) {
+            retransmit_sack_holes();
+        }
+    }
+}
+
+// 把已有的数据全部发出也凑不满一个 MSS 时, cork 状态下总是等待, Nagle 则在还有未确认数据时等待 (RFC 1122 4.2.3.4)
+// 只受窗口限制而变小的 segment, 以及输入已经结束 (随后就是 FIN) 的最后一段数据不等待
+bool TCPSender::hold_partial_segment(const size_t payload_size) const {
+    const bool data_limited = payload_size == _stream.buffer_size();
+    if (payload_size == 0 || payload_size >= _send_mss || !data_limited || _stream.input_ended()) {
+        return false;
+    }
+    return _corked || (_nagle && bytes_in_flight() > 0);
+}
+
+void TCPSender::add_rtt_sample(const uint64_t rtt) {
+    _congestion_control->on_rtt_sample(rtt);
+    _rtt_estimator.add_sample(rtt);
+    if (_adaptive_rto) {
+        _timer.set_RTO(_rtt_estimator.RTO());
+    }
+}
+
+// SYN 中携带 MSS 等选项, 告诉对端本端能接收的最大 payload 以及支持的扩展
+void TCPSender::set_syn_options(TCPHeader &header) const {
+    header.syn = true;
+    header.mss = _max_payload_size;
+    header.sack_permitted = _sack_permitted;
+    if (_window_scaling) {
+        header.wscale = _recv_window_shift;
+    }
+    header.doff = (TCPHeader::LENGTH + header.options_length()) / 4;
+}
+
+// 重传从 entry 的哪里开始: GSO 的大 segment 常常只被确认了一部分, 已经确认的开头部分不再重传;
+// 普通 segment 总是整个重传
+uint64_t TCPSender::retransmit_start(const InFlightRing::Entry &entry) const {
+    if (entry.syn || entry.payload.size() <= _send_mss) {
+        return entry.seqno;
+    }
+    return max(entry.seqno, _recv_ackno);
+}
+
+// 重传时一次最多发一个 MSS: GSO 的大 segment 从 start 开始按 MSS 切开 (类似 Linux 的 tcp_fragment),
+// 只有丢失的那一片被重传, 而不是整个 (最多 64 KiB) 的 segment; 切片也不越过 limit
+// 正好在 payload 结尾停下时带上 FIN, 不为它单独重传一次
+uint64_t TCPSender::retransmit_end(const InFlightRing::Entry &entry, const uint64_t start, const uint64_t limit) const {
+    const bool syn = entry.syn && start == entry.seqno;
+    const uint64_t end = min({start + syn + _send_mss, limit, entry.end()});
+    if (entry.fin && end == entry.end() - 1 && limit >= entry.end()) {
+        return entry.end();
+    }
+    return end;
+}
+
+// 由重传队列中的 entry 重建序号 [start, end) 的 segment, 与 entry 共享 payload
+TCPSegment TCPSender::in_flight_segment(const InFlightRing::Entry &entry,
+                                        const uint64_t start,
+                                        const uint64_t end) const {
+    TCPSegment segment;
+    const uint64_t data_start = entry.seqno + entry.syn;
+    const uint64_t payload_end = min(end - data_start, uint64_t{entry.payload.size()});
+    segment.payload() = entry.payload;
+    segment.payload().remove_suffix(entry.payload.size() - payload_end);
+    segment.payload().remove_prefix(start > data_start ? start - data_start : 0);
+    if (entry.syn && start == entry.seqno) {
+        set_syn_options(segment.header());
+    }
+    segment.header().fin = entry.fin && end == entry.end();
+    segment.header().seqno = wrap(start, _isn);
+    return segment;
+}
+
+// 开启 GSO 时取不超过 MAX_GSO_PAYLOAD_SIZE 的 MSS 整数倍, 保证切分后除最后一段外都是满的
+size_t TCPSender::max_segment_payload() const {
+    if (!_gso) {
+        return _send_mss;
+    }
+    return max(_send_mss, TCPConfig::MAX_GSO_PAYLOAD_SIZE / _send_mss * _send_mss);
+}
+
+void TCPSender::retransmit_first_unacked() {
+    if (_in_flight.empty()) {
+        return;
+    }
+    const InFlightRing::Entry &entry = _in_flight.front();
+    const uint64_t start = retransmit_start(entry);
+    const uint64_t end = retransmit_end(entry, start, entry.end());
+    _segments_out.push(in_flight_segment(entry, start, end));
+    _retransmitted_high = end;
+    _rtt_timing = false;
+}
+
+void TCPSender::update_scoreboard(const vector<SACKBlock> &sack, const uint64_t abs_ackno) {
+    // 和 StreamReassembler 一样用区间 map 记录, 插入时合并重叠或相邻的区间
+    for (const auto &block : sack) {
+        uint64_t start = max(unwrap(block.left, _isn, _next_seqno), abs_ackno);
+        uint64_t end = unwrap(block.right, _isn, _next_seqno);
+        if (start >= end || end > _next_seqno) {
+            continue;
+        }
+        auto iter = _sacked.upper_bound(start);
+        if (iter != _sacked.begin() && prev(iter)->second >= start) {
+            iter = prev(iter);
+            start = iter->first;
+        }
+        while (iter != _sacked.end() && iter->first <= end) {
+            end = max(end, iter->second);
+            _sacked_bytes -= iter->second - iter->first;
+            iter = _sacked.erase(iter);
+        }
+        _sacked.emplace_hint(iter, start, end);
+        _sacked_bytes += end - start;
+    }
+
+    // 已经被累积确认的部分从记分板中去掉
+    while (!_sacked.empty() && _sacked.begin()->first < abs_ackno) {
+        auto first = _sacked.begin();
+        const uint64_t end = first->second;
+        _sacked_bytes -= end - first->first;
+        _sacked.erase(first);
+        if (end > abs_ackno) {
+            _sacked.emplace(abs_ackno, end);
+            _sacked_bytes += end - abs_ackno;
+        }
+    }
+}
+
+// 重传记分板上的空洞: 最高 SACK 序号之下, 没有被 SACK, 本次恢复中也没有重传过的序号 (RFC 6675)
+// 空洞按 MSS 切片, 跳过 GSO 大 segment 中已经被 SACK 的部分
+// pipe 估计网络中实际还在传输的字节数, 不超过拥塞窗口 (不计快速恢复的膨胀)
+void TCPSender::retransmit_sack_holes() {
+    if (_sacked.empty()) {
+        return;
+    }
+    const uint64_t highest_sacked = prev(_sacked.end())->second;
+    // 依次对每个空洞切片 [start, end) 调用 visit, visit 返回 false 时停止
+    const auto for_each_hole = [&](const auto &visit) {
+        for (size_t i = 0; i < _in_flight.size() && _in_flight[i].seqno < highest_sacked; i++) {
+            const InFlightRing::Entry &entry = _in_flight[i];
+            // 队首的 segment 可能被确认了一部分 (对端的窗口截断了它), 确认过的部分不算空洞
+            uint64_t start = max({retransmit_start(entry), _retransmitted_high, _recv_ackno});
+            while (start < min(entry.end(), highest_sacked)) {
+                // start 在 highest_sacked 之下, 又不在任何 SACK 区间内, 所以之后一定还有 SACK 区间
+                const auto next = _sacked.upper_bound(start);
+                if (next != _sacked.begin() && prev(next)->second > start) {
+                    start = prev(next)->second;
+                    continue;
+                }
+                const uint64_t end = retransmit_end(entry, start, next->first);
+                if (!visit(entry, start, end)) {
+                    return;
+                }
+                start = end;
+            }
+        }
+    };
+
+    uint64_t lost_bytes = 0;
+    for_each_hole([&](const InFlightRing::Entry &, const uint64_t start, const uint64_t end) {
+        lost_bytes += end - start;
+        return true;
+    });
+    // 饱和相减: 记分板和空洞的估计出错时 pipe 为 0, 而不是回绕成一个巨大的值, 让重传全部停下
+    const uint64_t accounted = _sacked_bytes + lost_bytes;
+    uint64_t pipe = bytes_in_flight() > accounted ? bytes_in_flight() - accounted : 0;
+
+    for_each_hole([&](const InFlightRing::Entry &entry, const uint64_t start, const uint64_t end) {
+        if (pipe >= _congestion_control->cwnd()) {
+            return false;
+        }
+        _segments_out.push(in_flight_segment(entry, start, end));
+        _retransmitted_high = end;
+        pipe += end - start;
+        _rtt_timing = false;
+        return true;
+    });
+}
+
 // 该函数发送空的数据包, 仅用于 ACK 确认完成
 void TCPSender::send_empty_segment() {
     TCPSegment segment;
@@ -196,4 +626,21 @@ void TCPSender::send_empty_segment(bool SYN, bool FIN, bool RST) {
     segment.header().rst = RST;
     _next_seqno += segment.length_in_sequence_space();
     _segments_out.emplace(std::move(segment));
+    update_state();
+}
+
+// 与 TCPState::state_summary 原先按字符串计算的规则相同
+// 只发了 SYN 时 _next_seqno 等于在途字节数, FIN 只在字节流结束后发出
+void TCPSender::update_state() {
+    if (_next_seqno == 0) {
+        _state = TCPSenderState::CLOSED;
+    } else if (_next_seqno == _bytes_in_flight) {
+        _state = TCPSenderState::SYN_SENT;
+    } else if (!_set_fin) {
+        _state = TCPSenderState::SYN_ACKED;
+    } else if (_bytes_in_flight > 0) {
+        _state = TCPSenderState::FIN_SENT;
+    } else {
+        _state = TCPSenderState::FIN_ACKED;
+    }
 }
\ No newline at end of file
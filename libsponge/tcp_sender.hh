@@ -1,13 +1,22 @@
 #ifndef SPONGE_LIBSPONGE_TCP_SENDER_HH
 #define SPONGE_LIBSPONGE_TCP_SENDER_HH
 
+#include "buffer.hh"
 #include "byte_stream.hh"
+#include "congestion_control.hh"
+#include "memory_ledger.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
+#include <cmath>
 #include <functional>
+#include <limits>
+#include <map>
+#include <memory>
 #include <queue>
+#include <vector>
 
 // 构建一个 Timer 类, 用作定时器
 
@@ -15,12 +24,14 @@ class Timer {
   private:
     uint64_t _init_RTO = 0;      // 初始RTO
     uint64_t _cur_RTO = 0;       // 指数避退的RTO
+    uint64_t _max_RTO = std::numeric_limits<uint64_t>::max();  // 指数避退的上限
     uint64_t _elapsed_time = 0;  // 定时器开始到现在的时间, 通过 tick 来更新
     bool _running = false;       // 记录定时器是否开始
 
   public:
     Timer() {}
     Timer(const uint64_t RTO) : _init_RTO(RTO), _cur_RTO(RTO) {}
+    Timer(const uint64_t RTO, const uint64_t max_RTO) : _init_RTO(RTO), _cur_RTO(RTO), _max_RTO(max_RTO) {}
     // 计时器 start
     void start() {
         _elapsed_time = 0;
@@ -34,7 +45,13 @@ class Timer {
     void reset() { _cur_RTO = _init_RTO; }
 
     // 指数避退
-    void reset_double() { _cur_RTO *= 2; }
+    void reset_double() { _cur_RTO = std::min(_cur_RTO * 2, std::max(_max_RTO, _cur_RTO)); }
+
+    // 更新 RTO (自适应 RTO 得到新的估计值时), 下一次 reset 开始生效
+    void set_RTO(const uint64_t RTO) { _init_RTO = RTO; }
+
+    // 当前 RTO, 包括指数避退
+    uint64_t RTO() const { return _cur_RTO; }
 
     // 定时器 tick
     void tick(const size_t ms_since_last_tick) {
@@ -48,6 +65,97 @@ class Timer {
 
     // check running
     bool check_running() const { return _running; }
+
+    // 距离超时还有多少毫秒 (已经超时为 0)
+    uint64_t remaining() const { return _elapsed_time >= _cur_RTO ? 0 : _cur_RTO - _elapsed_time; }
+};
+
+// RFC 6298 的 RTT 估计: 平滑 RTT (SRTT) 和 RTT 偏差 (RTTVAR), 由它们得到 RTO
+class RTTEstimator {
+  private:
+    double _srtt = 0;
+    double _rttvar = 0;
+    bool _has_sample = false;
+    uint64_t _min_RTO;
+    uint64_t _max_RTO;
+
+  public:
+    RTTEstimator(const uint64_t min_RTO, const uint64_t max_RTO) : _min_RTO(min_RTO), _max_RTO(max_RTO) {}
+
+    // 加入一个 RTT 样本 (毫秒), 重传过的 segment 不能作为样本 (Karn 算法)
+    void add_sample(const uint64_t rtt) {
+        const double r = static_cast<double>(rtt);
+        if (!_has_sample) {
+            _srtt = r;
+            _rttvar = r / 2;
+            _has_sample = true;
+        } else {
+            _rttvar = 0.75 * _rttvar + 0.25 * std::abs(_srtt - r);
+            _srtt = 0.875 * _srtt + 0.125 * r;
+        }
+    }
+
+    bool has_sample() const { return _has_sample; }
+
+    // 平滑 RTT, 没有样本时为 0
+    uint64_t srtt() const { return static_cast<uint64_t>(_srtt + 0.5); }
+
+    // RTO = SRTT + max(G, 4 * RTTVAR), G 为时钟粒度 1 毫秒, 并限制在 [min, max] 之间
+    uint64_t RTO() const {
+        const double rto = _srtt + std::max(1.0, 4 * _rttvar);
+        return std::clamp(static_cast<uint64_t>(std::ceil(rto)), _min_RTO, _max_RTO);
+    }
+};
+
+// 已发送但未被完全确认的 segment, 按序号连续排列在环形缓冲区中
+// 每项只保存 abs seqno, 占用的序号长度, SYN/FIN 标志, 以及与发出的 segment 共享的 payload, 重传时再重建 segment
+class InFlightRing {
+  public:
+    struct Entry {
+        uint64_t seqno = 0;   // abs seqno
+        uint64_t length = 0;  // 占用的序号空间, SYN 和 FIN 各算一个
+        bool syn = false;
+        bool fin = false;
+        Buffer payload{};
+
+        uint64_t end() const { return seqno + length; }
+    };
+
+  private:
+    // 容量总是 2 的幂, 下标用位与回绕
+    std::vector<Entry> _entries = std::vector<Entry>(16);
+    size_t _head = 0;
+    size_t _size = 0;
+    // entry 的 payload 总字节数, 计入 MemoryLedger
+    MemoryCharge _charge{};
+
+  public:
+    bool empty() const { return _size == 0; }
+    size_t size() const { return _size; }
+
+    // 第 i 个 entry, 0 为最早发送的
+    const Entry &operator[](const size_t i) const { return _entries[(_head + i) & (_entries.size() - 1)]; }
+    const Entry &front() const { return (*this)[0]; }
+
+    // 追加一个刚发送的 segment, 它的 seqno 必须紧接着最后一个 entry 的 end()
+    void push_back(Entry entry);
+
+    // 弹出被 ackno 完全确认的 entry: 二分查找第一个 end() > ackno 的 entry, 之前的一次性弹出
+    // 返回弹出的序号空间长度
+    uint64_t pop_acked(const uint64_t ackno);
+
+    // 所有 entry 的 payload 总字节数
+    size_t payload_bytes() const { return _charge.bytes(); }
+};
+
+//! \brief Where a TCPSender is in its stream (TCPState::state_summary() describes each in words)
+enum class TCPSenderState {
+    ERROR,      //!< the connection was reset
+    CLOSED,     //!< no SYN sent yet
+    SYN_SENT,   //!< SYN sent, nothing acknowledged
+    SYN_ACKED,  //!< stream ongoing
+    FIN_SENT,   //!< FIN sent, not fully acknowledged
+    FIN_ACKED,  //!< FIN sent and everything acknowledged
 };
 
 //! \brief The "sender" part of a TCP implementation.
@@ -85,11 +193,86 @@ class TCPSender {
     // 窗口大小
     // _window_size 初始化为 1，否则TCP 刚开始就丢包的话 _window_size = 0 只会认为接收方窗口为0, 不会做指数退避 RTO*2
     uint64_t _window_size{1};
-    // 已经发送出去但是还未被 ack 确认的字节数, 即 _segments_unackno 的字节数
+    // 本端允许的最大 payload (在 SYN 中作为 MSS 选项通告), 以及按对端 MSS 调整后实际使用的值
+    size_t _max_payload_size;
+    size_t _send_mss;
+    // 拥塞控制, 发送窗口取接收方窗口和 cwnd 中较小的一个
+    std::unique_ptr<CongestionControl> _congestion_control;
+    // 发送方自己的时钟, 即 tick 的累计毫秒数
+    uint64_t _time_ms{0};
+    // 一次只对一个 segment 计时测量 RTT, 重传过的 segment 不计 (Karn 算法)
+    bool _rtt_timing{false};
+    uint64_t _rtt_seqno_end{0};
+    uint64_t _rtt_sent_at{0};
+    // 自适应 RTO (RFC 6298), 关闭时 RTO 始终从 _initial_retransmission_timeout 开始
+    bool _adaptive_rto;
+    RTTEstimator _rtt_estimator;
+    // 快速重传与 NewReno 快速恢复
+    static constexpr unsigned DUPLICATE_ACK_THRESHOLD = 3;
+    bool _fast_retransmit;
+    unsigned _duplicate_acks_cnt{0};
+    bool _in_fast_recovery{false};
+    // 进入快速恢复时的 _next_seqno, 确认到这里才退出恢复
+    uint64_t _recover{0};
+    // 快速恢复期间 cwnd 的膨胀量 (字节)
+    size_t _recovery_inflation{0};
+    uint64_t _fast_retransmit_cnt{0};
+
+    // SACK (RFC 2018): 双方都在 SYN 中带了 SACK-permitted 才启用
+    bool _sack_permitted;
+    // 记分板: 对端通过 SACK 报告已经收到的区间 [start, end) (abs seqno), 都在 _recv_ackno 之上
+    std::map<uint64_t, uint64_t> _sacked{};
+    uint64_t _sacked_bytes{0};
+    // 本次快速恢复中已经重传到的位置, 之下的空洞不再重复重传
+    uint64_t _retransmitted_high{0};
+
+    // 窗口缩放 (RFC 7323): 双方的 SYN 都带了 window scale 选项才启用
+    bool _window_scaling;
+    // 本端通告窗口时右移的位数 (由接收缓冲区大小决定), 以及对端通告的窗口需要左移的位数
+    uint8_t _recv_window_shift;
+    uint8_t _send_window_shift{0};
+
+    // 时间戳 (RFC 7323): 双方的 SYN 都带了 timestamps 选项才启用, 之后每个确认新数据的 ACK 都回显
+    // 了被确认的 segment 发出时的时钟, 用它测 RTT, 重传过的 segment 也可以测 (不再需要 Karn 算法)
+    bool _timestamps;
+
+    // Nagle 算法, 以及应用显式的 cork (类似 TCP_CORK): 不足一个 MSS 的 segment 暂不发送
+    bool _nagle;
+    bool _corked{false};
+
+    // 发送节奏控制 (pacing): 新数据先从令牌桶中取得额度 (字节), 令牌在 tick 中按 pacing_rate() 补充
+    // 额度允许透支一个 segment, 欠下的部分由之后的 tick 补上; 重传不受限制
+    static constexpr int64_t PACING_GAIN_SLOW_START = 200;  // 百分比
+    static constexpr int64_t PACING_GAIN = 120;
+    static constexpr int64_t PACING_BURST_SEGMENTS = 2;
+    bool _pacing;
+    int64_t _pacing_tokens{0};
+
+    // GSO: 一个 segment 最多装下 max_segment_payload() 字节, 由 adapter 按 _send_mss 切分后发送
+    bool _gso;
+
+    bool pacing_active() const { return _pacing && _rtt_estimator.has_sample(); }
+    int64_t pacing_rate() const;
+    size_t max_segment_payload() const;
+    bool hold_partial_segment(const size_t payload_size) const;
+    void set_syn_options(TCPHeader &header) const;
+    uint64_t retransmit_start(const InFlightRing::Entry &entry) const;
+    uint64_t retransmit_end(const InFlightRing::Entry &entry, const uint64_t start, const uint64_t limit) const;
+    TCPSegment in_flight_segment(const InFlightRing::Entry &entry, const uint64_t start, const uint64_t end) const;
+    void duplicate_ack_received();
+    void add_rtt_sample(const uint64_t rtt);
+    void retransmit_first_unacked();
+    void update_scoreboard(const std::vector<SACKBlock> &sack, const uint64_t abs_ackno);
+    void retransmit_sack_holes();
+    // 已经发送出去但是还未被 ack 确认的字节数, 即 _in_flight 的序号长度
     uint64_t _bytes_in_flight{0};
     // 符合上述描述的 TCPSegment 字段, 保存那些没有被ack 确认的 TCPSegment
     // _segments_out 保存的是发送的 TCPsegment
-    std::queue<TCPSegment> _segments_unackno{};
+    // 已发送未确认的 segment (与 _segments_out 共享 payload), ACK 时二分查找批量弹出
+    InFlightRing _in_flight{};
+    // 状态在 _next_seqno, _bytes_in_flight 或 _set_fin 改变时更新, ERROR 由 state() 查看字节流得到
+    TCPSenderState _state{TCPSenderState::CLOSED};
+    void update_state();
 
   public:
     //! Initialize a TCPSender
@@ -97,6 +280,9 @@ class TCPSender {
               const uint16_t retx_timeout = TCPConfig::TIMEOUT_DFLT,
               const std::optional<WrappingInt32> fixed_isn = {});
 
+    //! Initialize a TCPSender from a connection's configuration
+    explicit TCPSender(const TCPConfig &config);
+
     //! \name "Input" interface for the writer
     //!@{
     ByteStream &stream_in() { return _stream; }
@@ -107,7 +293,11 @@ class TCPSender {
     //!@{
 
     //! \brief A new acknowledgment was received
-    void ack_received(const WrappingInt32 ackno, const uint16_t window_size);
+    void ack_received(const WrappingInt32 ackno,
+                      const uint64_t window_size,
+                      const bool carries_data = false,
+                      const std::vector<SACKBlock> &sack = {},
+                      const std::optional<uint32_t> tsecr = {});
 
     //! \brief Generate an empty-payload segment (useful for creating empty ACK segments)
     void send_empty_segment();
@@ -119,6 +309,36 @@ class TCPSender {
     void tick(const size_t ms_since_last_tick);
     //!@}
 
+    //! \brief The peer's SYN carried an MSS option: never send payloads larger than `peer_mss`
+    void set_peer_mss(const uint16_t peer_mss);
+
+    //! \brief The peer's SYN arrived, with or without the SACK-permitted option
+    void set_peer_sack_permitted(const bool permitted) { _sack_permitted = _sack_permitted && permitted; }
+
+    //! \brief Hold back segments smaller than the MSS until uncork() (like TCP_CORK)
+    //! \note Full-sized segments, and the last data once the stream has ended, are still sent
+    void cork() { _corked = true; }
+
+    //! \brief Stop holding back small segments; call fill_window() to send what was held
+    void uncork() { _corked = false; }
+
+    //! \brief Whether cork() is in effect
+    bool corked() const { return _corked; }
+
+    //! \brief Milliseconds until pacing lets the next segment go, if data is waiting only for pacing
+    //! \note The owner can sleep until then instead of until its next regular tick
+    std::optional<uint64_t> pacing_delay() const;
+
+    //! \brief Milliseconds until tick() has something to do (the retransmission timer expires, or pacing
+    //! lets waiting data go), or empty if neither timer is running
+    std::optional<uint64_t> next_timeout() const;
+
+    //! \brief The peer's SYN arrived, with or without the window scale option
+    void set_peer_window_scale(const std::optional<uint8_t> peer_shift);
+
+    //! \brief The peer's SYN arrived, with or without the timestamps option
+    void set_peer_timestamps(const bool permitted) { _timestamps = _timestamps && permitted; }
+
     //! \name Accessors
     //!@{
 
@@ -130,6 +350,53 @@ class TCPSender {
     //! \brief Number of consecutive retransmissions that have occurred in a row
     unsigned int consecutive_retransmissions() const;
 
+    //! \brief Where the sender is in its stream, kept up to date as segments are sent and acknowledged
+    TCPSenderState state() const { return _stream.error() ? TCPSenderState::ERROR : _state; }
+
+    //! \brief Largest payload the sender currently puts in one segment
+    size_t max_payload_size() const { return _send_mss; }
+
+    //! \brief Current congestion window, in bytes, including any inflation during fast recovery
+    //! (unbounded without congestion control)
+    size_t congestion_window() const;
+
+    //! \brief Most bytes the sender may have in flight: the smaller of the peer's window and the congestion window
+    uint64_t send_window() const;
+
+    //! \brief Bytes of memory held by the outbound stream and the data sent but not yet acknowledged
+    size_t memory_usage() const { return _stream.memory_usage() + _in_flight.payload_bytes(); }
+
+    //! \brief Whether the sender is repairing a loss detected by duplicate ACKs
+    bool in_fast_recovery() const { return _in_fast_recovery; }
+
+    //! \brief Number of times three duplicate ACKs triggered a fast retransmit
+    uint64_t fast_retransmits() const { return _fast_retransmit_cnt; }
+
+    //! \brief Whether SACK is offered (before the peer's SYN) or was negotiated (after it)
+    bool sack_permitted() const { return _sack_permitted; }
+
+    //! \brief Bytes in flight that the peer has reported holding through SACK
+    uint64_t sacked_bytes() const { return _sacked_bytes; }
+
+    //! \brief Shift to apply to the windows the peer advertises (0 unless window scaling was negotiated)
+    uint8_t send_window_shift() const { return _window_scaling ? _send_window_shift : 0; }
+
+    //! \brief Shift to apply to the windows we advertise (0 unless window scaling was negotiated)
+    uint8_t recv_window_shift() const { return _window_scaling ? _recv_window_shift : 0; }
+
+    //! \brief Whether timestamps are offered (before the peer's SYN) or were negotiated (after it)
+    bool timestamps() const { return _timestamps; }
+
+    //! \brief The sender's clock in milliseconds, truncated to 32 bits: the TSval for a segment sent now
+    uint32_t timestamp_clock() const { return static_cast<uint32_t>(_time_ms); }
+
+    //! \brief Smoothed round-trip time in milliseconds, or 0 before the first measurement
+    //! \note RTTs are measured whether or not the adaptive RTO is enabled
+    uint64_t smoothed_rtt() const { return _rtt_estimator.srtt(); }
+
+    //! \brief Current retransmission timeout in milliseconds, including any exponential backoff
+    uint64_t retransmission_timeout() const { return _timer.RTO(); }
+
     //! \brief TCPSegments that the TCPSender has enqueued for transmission.
     //! \note These must be dequeued and sent by the TCPConnection,
     //! which will need to fill in the fields that are set by the TCPReceiver
@@ -3,6 +3,7 @@
 #include "util.hh"
 
 #include <algorithm>
+#include <cerrno>
 #include <fcntl.h>
 #include <iostream>
 #include <stdexcept>
@@ -51,7 +52,12 @@ void FileDescriptor::read(std::string &str, const size_t limit) {
     const size_t size_to_read = min(BUFFER_SIZE, limit);
     str.resize(size_to_read);
 
-    ssize_t bytes_read = SystemCall("read", ::read(fd_num(), str.data(), size_to_read));
+    ssize_t bytes_read = SystemCall("read", ::read(fd_num(), str.data(), size_to_read), EAGAIN);
+    // a non-blocking fd with nothing to read: not a read, and not EOF
+    if (bytes_read < 0) {
+        str.clear();
+        return;
+    }
     if (limit > 0 && bytes_read == 0) {
         _internal_fd->_eof = true;
     }
@@ -73,6 +79,31 @@ string FileDescriptor::read(const size_t limit) {
     return ret;
 }
 
+//! \param[in] iovecs are the regions to be filled, in order
+//! \param[in] count is the number of regions
+//! \returns the number of bytes read
+size_t FileDescriptor::read(const iovec *iovecs, const size_t count) {
+    size_t limit = 0;
+    for (size_t i = 0; i < count; i++) {
+        limit += iovecs[i].iov_len;
+    }
+
+    const ssize_t bytes_read = SystemCall("readv", ::readv(fd_num(), iovecs, static_cast<int>(count)), EAGAIN);
+    if (bytes_read < 0) {
+        return 0;
+    }
+    if (limit > 0 && bytes_read == 0) {
+        _internal_fd->_eof = true;
+    }
+    if (bytes_read > static_cast<ssize_t>(limit)) {
+        throw runtime_error("readv() read more than requested");
+    }
+
+    register_read();
+
+    return bytes_read;
+}
+
 size_t FileDescriptor::write(BufferViewList buffer, const bool write_all) {
     size_t total_bytes_written = 0;
 
@@ -56,11 +56,16 @@ class FileDescriptor {
     ~FileDescriptor() = default;
 
     //! Read up to `limit` bytes
+    //! \note On a non-blocking fd with nothing to read, returns nothing and does not count as a read
     std::string read(const size_t limit = std::numeric_limits<size_t>::max());
 
     //! Read up to `limit` bytes into `str` (caller can allocate storage)
     void read(std::string &str, const size_t limit = std::numeric_limits<size_t>::max());
 
+    //! Read into `count` caller-provided, possibly discontiguous regions (e.g. the free space of a ByteStream)
+    //! \note On a non-blocking fd with nothing to read, returns 0 and does not count as a read
+    size_t read(const iovec *iovecs, const size_t count);
+
     //! Write a string, possibly blocking until all is written
     size_t write(const char *str, const bool write_all = true) { return write(BufferViewList(str), write_all); }
 
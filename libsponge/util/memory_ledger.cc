@@ -0,0 +1,59 @@
+#include "memory_ledger.hh"
+
+using namespace std;
+
+MemoryLedger &MemoryLedger::global() {
+    // deliberately leaked: buffers with static storage duration may release their charges after main() returns
+    static MemoryLedger *const ledger = new MemoryLedger;
+    return *ledger;
+}
+
+void MemoryLedger::charge(const size_t bytes) {
+    const size_t used = _used.fetch_add(bytes, memory_order_relaxed) + bytes;
+    size_t high = _high_watermark.load(memory_order_relaxed);
+    while (used > high and not _high_watermark.compare_exchange_weak(high, used, memory_order_relaxed)) {
+        // `high` now holds what another thread raised it to: compare again
+    }
+    report(used);
+}
+
+void MemoryLedger::release(const size_t bytes) { report(_used.fetch_sub(bytes, memory_order_relaxed) - bytes); }
+
+void MemoryLedger::set_limits(const size_t soft_limit, const size_t hard_limit) {
+    _soft_limit.store(soft_limit, memory_order_relaxed);
+    _hard_limit.store(hard_limit, memory_order_relaxed);
+    report(used());
+}
+
+MemoryPressure MemoryLedger::pressure_at(const size_t used) const {
+    const size_t hard = hard_limit(), soft = soft_limit();
+    if (hard != 0 and used > hard) {
+        return MemoryPressure::Critical;
+    }
+    if (soft != 0 and used > soft) {
+        return MemoryPressure::Moderate;
+    }
+    return MemoryPressure::None;
+}
+
+void MemoryLedger::set_pressure_hook(function<void(MemoryPressure)> hook) {
+    const lock_guard<mutex> lock(_hook_mutex);
+    _hook = move(hook);
+}
+
+void MemoryLedger::report(const size_t used) {
+    const MemoryPressure level = pressure_at(used);
+    // the common case, no change, only reads
+    if (_reported.load(memory_order_relaxed) == level or _reported.exchange(level) == level) {
+        return;
+    }
+    // call a copy, without the lock held, so that the hook may itself charge, release or set the hook
+    function<void(MemoryPressure)> hook;
+    {
+        const lock_guard<mutex> lock(_hook_mutex);
+        hook = _hook;
+    }
+    if (hook) {
+        hook(level);
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef SPONGE_LIBSPONGE_MEMORY_LEDGER_HH
+#define SPONGE_LIBSPONGE_MEMORY_LEDGER_HH
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+//! \brief How far the memory charged to a MemoryLedger is over its limits
+enum class MemoryPressure {
+    None,      //!< at or below the soft limit (or no limit is set)
+    Moderate,  //!< above the soft limit: stop taking on more data
+    Critical,  //!< above the hard limit: shed data that can be had again
+};
+
+//! \brief An account of the memory that stream buffers hold, kept by the buffers themselves
+//! \details Every ByteStream, StreamReassembler window and TCPSender retransmission queue charges the bytes it
+//! holds to the process-wide ledger, global(), through a MemoryCharge, so that used() is the memory buffered
+//! by every connection together and high_watermark() the most it has been.
+//!
+//! With limits set, pressure() says how far used() is over them, and the TCP code responds on its own:
+//! above the soft limit a TCPConnection stops opening its receive window further (the window it advertises
+//! shrinks as data arrives, without its right edge ever moving back), stops growing its buffers, and a
+//! TCPDemux refuses new connections; above the hard limit a TCPConnection also drops, and stops storing,
+//! data that arrived out of order, which the peer will send again. The pressure hook is told whenever the
+//! level changes, for the owner to add its own response (e.g. closing idle connections).
+//!
+//! All methods may be called from any thread.
+class MemoryLedger {
+  private:
+    std::atomic<size_t> _used{0};
+    std::atomic<size_t> _high_watermark{0};
+    std::atomic<size_t> _soft_limit{0};
+    std::atomic<size_t> _hard_limit{0};
+    std::atomic<MemoryPressure> _reported{MemoryPressure::None};  //!< the level last passed to the hook
+
+    std::mutex _hook_mutex{};
+    std::function<void(MemoryPressure)> _hook{};
+
+    //! The pressure when `used` bytes are charged
+    MemoryPressure pressure_at(const size_t used) const;
+
+    //! Tell the hook if the pressure at `used` bytes is not the level it last heard of
+    void report(const size_t used);
+
+  public:
+    //! \brief The ledger that stream buffers charge (it is never destroyed, so buffers may outlive main())
+    static MemoryLedger &global();
+
+    //! \name Accounting
+    //!@{
+
+    //! \brief Record that `bytes` more are held
+    void charge(const size_t bytes);
+
+    //! \brief Record that `bytes` are no longer held
+    void release(const size_t bytes);
+
+    //! \brief Bytes held now
+    size_t used() const { return _used.load(std::memory_order_relaxed); }
+
+    //! \brief Most bytes held at once since the ledger was created or reset_high_watermark() was called
+    size_t high_watermark() const { return _high_watermark.load(std::memory_order_relaxed); }
+
+    //! \brief Start the high watermark again from used()
+    //! \returns the high watermark until now
+    size_t reset_high_watermark() { return _high_watermark.exchange(used()); }
+    //!@}
+
+    //! \name Pressure
+    //!@{
+
+    //! \brief Set the limits in bytes that pressure() measures used() against; 0 means no limit
+    void set_limits(const size_t soft_limit, const size_t hard_limit);
+
+    size_t soft_limit() const { return _soft_limit.load(std::memory_order_relaxed); }  //!< 0 if none
+    size_t hard_limit() const { return _hard_limit.load(std::memory_order_relaxed); }  //!< 0 if none
+
+    //! \brief How far used() is over the limits
+    MemoryPressure pressure() const { return pressure_at(used()); }
+
+    //! \brief Call `hook` with the new level whenever pressure() changes level (empty for none)
+    //! \note The hook runs on the thread whose charge or release changed the level, with no lock held, so it
+    //! may itself charge or release memory (e.g. by closing connections), or set the hook. If it changes the
+    //! level again, the hook is called again, from within the first call.
+    void set_pressure_hook(std::function<void(MemoryPressure)> hook);
+    //!@}
+};
+
+//! \brief The bytes one buffer has charged to MemoryLedger::global(), released when it is destroyed
+//! \details A buffer keeps one as a member and calls set() with its new size whenever that changes; moving
+//! the buffer moves the charge, and copying it charges the copy the same amount.
+class MemoryCharge {
+  private:
+    size_t _bytes = 0;
+
+  public:
+    //! \brief Charge or release the difference, so that `bytes` are charged
+    void set(const size_t bytes) {
+        if (bytes > _bytes) {
+            MemoryLedger::global().charge(bytes - _bytes);
+        } else if (bytes < _bytes) {
+            MemoryLedger::global().release(_bytes - bytes);
+        }
+        _bytes = bytes;
+    }
+
+    //! \brief Bytes charged
+    size_t bytes() const { return _bytes; }
+
+    //! \name construction and destruction
+    //!@{
+    MemoryCharge() = default;
+    ~MemoryCharge() { set(0); }
+    MemoryCharge(const MemoryCharge &other) { set(other._bytes); }
+    MemoryCharge(MemoryCharge &&other) noexcept : _bytes(std::exchange(other._bytes, 0)) {}
+    MemoryCharge &operator=(const MemoryCharge &other) {
+        set(other._bytes);
+        return *this;
+    }
+    MemoryCharge &operator=(MemoryCharge &&other) noexcept {
+        if (this != &other) {
+            set(0);
+            _bytes = std::exchange(other._bytes, 0);
+        }
+        return *this;
+    }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_MEMORY_LEDGER_HH
@@ -2,6 +2,7 @@
 
 #include "util.hh"
 
+#include <cerrno>
 #include <cstddef>
 #include <stdexcept>
 #include <unistd.h>
@@ -95,7 +96,14 @@ void UDPSocket::recv(received_datagram &datagram, const size_t mtu) {
     const ssize_t recv_len = SystemCall(
         "recvfrom",
         ::recvfrom(
-            fd_num(), datagram.payload.data(), datagram.payload.size(), MSG_TRUNC, datagram_source_address, &fromlen));
+            fd_num(), datagram.payload.data(), datagram.payload.size(), MSG_TRUNC, datagram_source_address, &fromlen),
+        EAGAIN);
+
+    // a non-blocking socket with nothing to read
+    if (recv_len < 0) {
+        datagram.payload.clear();
+        return;
+    }
 
     if (recv_len > ssize_t(mtu)) {
         throw runtime_error("recvfrom (oversized datagram)");
@@ -124,8 +132,12 @@ void sendmsg_helper(const int fd_num,
     message.msg_iov = iovecs.data();
     message.msg_iovlen = iovecs.size();
 
-    const ssize_t bytes_sent = SystemCall("sendmsg", ::sendmsg(fd_num, &message, 0));
+    const ssize_t bytes_sent = SystemCall("sendmsg", ::sendmsg(fd_num, &message, 0), EAGAIN);
 
+    // a non-blocking socket whose send buffer is full drops the datagram, as a full queue on the way would
+    if (bytes_sent < 0) {
+        return;
+    }
     if (size_t(bytes_sent) != payload.size()) {
         throw runtime_error("datagram payload too big for sendmsg()");
     }
@@ -136,6 +148,39 @@ void UDPSocket::sendto(const Address &destination, const BufferViewList &payload
     register_write();
 }
 
+void UDPSocket::sendto(const Address &destination, const vector<BufferViewList> &payloads) {
+    vector<vector<iovec>> iovecs;
+    vector<mmsghdr> messages(payloads.size());
+    iovecs.reserve(payloads.size());
+    for (size_t i = 0; i < payloads.size(); i++) {
+        iovecs.push_back(payloads[i].as_iovecs());
+        msghdr &message = messages[i].msg_hdr;
+        message.msg_name = const_cast<sockaddr *>(static_cast<const sockaddr *>(destination));
+        message.msg_namelen = destination.size();
+        message.msg_iov = iovecs.back().data();
+        message.msg_iovlen = iovecs.back().size();
+    }
+
+    // sendmmsg() may send only some of the datagrams; keep going with the rest
+    // (unless the send buffer of a non-blocking socket is full: then the rest are dropped)
+    size_t sent = 0;
+    while (sent < messages.size()) {
+        const int ret =
+            SystemCall("sendmmsg", ::sendmmsg(fd_num(), &messages[sent], messages.size() - sent, 0), EAGAIN);
+        if (ret < 0) {
+            break;
+        }
+        const size_t count = ret;
+        for (size_t i = sent; i < sent + count; i++) {
+            if (messages[i].msg_len != payloads[i].size()) {
+                throw runtime_error("datagram payload too big for sendmmsg()");
+            }
+        }
+        sent += count;
+        register_write();
+    }
+}
+
 void UDPSocket::send(const BufferViewList &payload) {
     sendmsg_helper(fd_num(), nullptr, 0, payload);
     register_write();
@@ -8,6 +8,7 @@
 #include <functional>
 #include <string>
 #include <sys/socket.h>
+#include <vector>
 
 //! \brief Base class for network sockets (TCP, UDP, etc.)
 //! \details Socket is generally used via a subclass. See TCPSocket and UDPSocket for usage examples.
@@ -68,11 +69,16 @@ class UDPSocket : public Socket {
     received_datagram recv(const size_t mtu = 65536);
 
     //! Receive a datagram and the Address of its sender (caller can allocate storage)
+    //! \note On a non-blocking socket with nothing to read, leaves the payload empty and does not count as a read
     void recv(received_datagram &datagram, const size_t mtu = 65536);
 
     //! Send a datagram to specified Address
+    //! \note A non-blocking socket drops the datagram if its send buffer is full
     void sendto(const Address &destination, const BufferViewList &payload);
 
+    //! Send several datagrams to the same Address with as few [sendmmsg(2)](\ref man2::sendmmsg) calls as possible
+    void sendto(const Address &destination, const std::vector<BufferViewList> &payloads);
+
     //! Send datagram to the socket's connected address (must call connect() first)
     void send(const BufferViewList &payload);
 };
@@ -0,0 +1,102 @@
+#ifndef SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+#define SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//! \brief A hierarchical timing wheel: timers that each carry a `PayloadT`, fired once their expiry time comes
+//! \details Time is in milliseconds, and starts at 0. Level 0 has one slot for each of the next 64 ms; the
+//! slots of each further level are 64 times wider, so the four levels reach about 4.6 hours ahead (a timer
+//! beyond that waits in the last level and is filed again when its slot comes round). advance() visits the
+//! level-0 slot of every millisecond that passes and fires the timers in it; when the span of a higher-level
+//! slot begins, its timers move down to the level that now fits them. The cost of advance() is therefore the
+//! time that passed plus the timers that fire or move, however many timers are waiting.
+//!
+//! There is no cancel(): an owner that changes its mind keeps its own record of the deadline it wants and
+//! ignores timers that fire for an older one (see TCPDemux and NetworkInterface).
+template <typename PayloadT>
+class TimerWheel {
+  private:
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+    static constexpr size_t LEVELS = 4;
+
+    struct Timer {
+        uint64_t expiry;
+        PayloadT payload;
+    };
+
+    std::array<std::array<std::vector<Timer>, SLOTS>, LEVELS> _slots{};
+    std::vector<Timer> _firing{};  //!< the slot being fired (kept to reuse its capacity)
+    uint64_t _now = 0;
+    size_t _size = 0;
+
+    //! File `timer` in the slot for its expiry, which must be no earlier than `earliest` (and `earliest` >= _now)
+    void file(Timer &&timer, const uint64_t earliest) {
+        const uint64_t at = std::max(timer.expiry, earliest);
+        const uint64_t delta = at - _now;
+        size_t level = 0;
+        while (level + 1 < LEVELS and delta >= (uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+            level++;
+        }
+        // beyond the last level: wait in its farthest slot, and be filed again from there
+        const uint64_t when = std::min(at, _now + (uint64_t{1} << (SLOT_BITS * LEVELS)) - 1);
+        _slots[level][(when >> (SLOT_BITS * level)) & (SLOTS - 1)].push_back(std::move(timer));
+    }
+
+  public:
+    //! \brief Fire `payload` at time `expiry`, or at the next millisecond if `expiry` is not in the future
+    void schedule(const uint64_t expiry, PayloadT payload) {
+        file(Timer{expiry, std::move(payload)}, _now + 1);
+        _size++;
+    }
+
+    //! \brief Move time forward to `now`, calling `on_expiry(expiry, payload)` for every timer due by then
+    //! \details Timers fire in order of expiry, and while one fires now() is its expiry (or, for a timer that
+    //! was scheduled already due, the millisecond after it was scheduled). `on_expiry` may schedule() new
+    //! timers, but must not call advance().
+    template <typename F>
+    void advance(const uint64_t now, F &&on_expiry) {
+        while (_now < now) {
+            if (_size == 0) {
+                _now = now;
+                return;
+            }
+            _now++;
+            // a higher-level slot whose span begins now moves down, starting from the highest level so
+            // that its timers can move down further in the same step
+            for (size_t level = LEVELS - 1; level > 0; level--) {
+                if ((_now & ((uint64_t{1} << (SLOT_BITS * level)) - 1)) == 0) {
+                    std::vector<Timer> &slot = _slots[level][(_now >> (SLOT_BITS * level)) & (SLOTS - 1)];
+                    std::vector<Timer> moving = std::move(slot);
+                    slot.clear();
+                    for (auto &timer : moving) {
+                        file(std::move(timer), _now);
+                    }
+                }
+            }
+            std::vector<Timer> &slot = _slots[0][_now & (SLOTS - 1)];
+            if (slot.empty()) {
+                continue;
+            }
+            _firing.swap(slot);
+            _size -= _firing.size();
+            for (auto &timer : _firing) {
+                on_expiry(timer.expiry, timer.payload);
+            }
+            _firing.clear();
+        }
+    }
+
+    //! \returns the current time
+    uint64_t now() const { return _now; }
+
+    //! \returns the number of timers waiting to fire
+    size_t size() const { return _size; }
+};
+
+#endif  // SPONGE_LIBSPONGE_TIMER_WHEEL_HH
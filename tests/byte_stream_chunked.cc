@@ -0,0 +1,72 @@
+#include "byte_stream.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            ByteStream bs{10, ByteStream::Storage::Chunked};
+            const Buffer written{string("hello world")};
+            test_err_if(bs.write(written) != 10, "write(Buffer) should be limited by the capacity");
+            test_err_if(bs.remaining_capacity() != 0, "stream should be full");
+            test_err_if(bs.peek_output(20) != "hello worl", "peek_output returned wrong bytes");
+
+            const BufferList first = bs.read_buffers(5);
+            test_err_if(first.buffers().size() != 1, "read_buffers from one chunk should return one Buffer");
+            test_err_if(first.concatenate() != "hello", "read_buffers returned wrong bytes");
+            test_err_if(first.buffers().front().str().data() != written.str().data(),
+                        "read_buffers should share storage with the written Buffer");
+            test_err_if(bs.bytes_read() != 5, "read_buffers should count as read");
+            test_err_if(bs.buffer_size() != 5, "read_buffers should pop from the stream");
+        }
+
+        {
+            ByteStream bs{100, ByteStream::Storage::Chunked};
+            bs.write(Buffer{string("abc")});
+            bs.write(string("defg"));
+            bs.write(Buffer{string("hij")});
+            const auto spans = bs.readable_spans(5);
+            test_err_if(spans[0] != "abc" or spans[1] != "de", "readable_spans should expose the first two chunks");
+            const auto wspans = bs.writable_spans();
+            test_err_if(wspans[0].iov_len != 0 or wspans[1].iov_len != 0, "a chunked stream has no writable spans");
+
+            const BufferList middle = bs.read_buffers(6);
+            test_err_if(middle.buffers().size() != 2, "read_buffers spanning two chunks should return two Buffers");
+            test_err_if(middle.concatenate() != "abcdef", "read_buffers returned wrong bytes");
+            test_err_if(bs.read(10) != "ghij", "read after read_buffers returned wrong bytes");
+            bs.end_input();
+            test_err_if(not bs.eof(), "stream should be at eof");
+        }
+
+        {
+            // random mix of writes and reads in both modes must behave identically
+            ByteStream ring{1000};
+            ByteStream chunked{1000, ByteStream::Storage::Chunked};
+            for (size_t i = 0; i < 2000; i++) {
+                string d(rd() % 300, 0);
+                generate(d.begin(), d.end(), [&] { return 'a' + (rd() % 26); });
+                const size_t ring_written = ring.write(d);
+                const size_t chunked_written = (rd() % 2) ? chunked.write(d) : chunked.write(Buffer{string(d)});
+                test_err_if(ring_written != chunked_written, "write lengths differ between modes");
+
+                const size_t len = rd() % 300;
+                const string expected = ring.read(len);
+                const string actual = (rd() % 2) ? chunked.read(len) : chunked.read_buffers(len).concatenate();
+                test_err_if(expected != actual, "read contents differ between modes");
+                test_err_if(ring.buffer_size() != chunked.buffer_size(), "buffer sizes differ between modes");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
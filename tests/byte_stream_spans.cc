@@ -0,0 +1,101 @@
+#include "byte_stream.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+static string span_contents(const array<string_view, 2> &spans) {
+    return string(spans[0]).append(spans[1]);
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            ByteStream bs{15};
+            auto wspans = bs.writable_spans();
+            test_err_if(wspans[0].iov_len + wspans[1].iov_len != 15, "writable spans should cover the whole capacity");
+            memcpy(wspans[0].iov_base, "hello", 5);
+            bs.commit_write(5);
+            test_err_if(bs.bytes_written() != 5, "commit_write should count as written");
+            test_err_if(bs.remaining_capacity() != 10, "commit_write should use up capacity");
+            test_err_if(span_contents(bs.readable_spans()) != "hello", "readable spans should expose committed bytes");
+            test_err_if(span_contents(bs.readable_spans(3)) != "hel", "readable spans should respect the length limit");
+            bs.consume(3);
+            test_err_if(bs.bytes_read() != 3, "consume should count as read");
+            test_err_if(bs.peek_output(10) != "lo", "consume should remove bytes from the head");
+        }
+
+        {
+            // push the head and tail around the end of the ring many times
+            const size_t CAPACITY = 100;
+            ByteStream bs{CAPACITY};
+            string expected;
+            size_t written = 0, read = 0;
+            for (size_t i = 0; i < 1000; i++) {
+                const size_t to_write = rd() % (bs.remaining_capacity() + 1);
+                string d(to_write, 0);
+                generate(d.begin(), d.end(), [&] { return 'a' + (rd() % 26); });
+
+                auto wspans = bs.writable_spans();
+                test_err_if(wspans[0].iov_len + wspans[1].iov_len != bs.remaining_capacity(),
+                            "writable spans should cover the remaining capacity");
+                const size_t first = min(to_write, wspans[0].iov_len);
+                memcpy(wspans[0].iov_base, d.data(), first);
+                memcpy(wspans[1].iov_base, d.data() + first, to_write - first);
+                bs.commit_write(to_write);
+                expected += d;
+                written += to_write;
+
+                const size_t to_read = rd() % (bs.buffer_size() + 1);
+                const auto rspans = bs.readable_spans(to_read);
+                test_err_if(span_contents(rspans) != expected.substr(0, to_read),
+                            "readable spans returned wrong bytes");
+                bs.consume(to_read);
+                expected.erase(0, to_read);
+                read += to_read;
+
+                test_err_if(bs.bytes_written() != written, "bytes_written mismatch");
+                test_err_if(bs.bytes_read() != read, "bytes_read mismatch");
+                test_err_if(bs.buffer_size() != expected.size(), "buffer_size mismatch");
+                test_err_if(bs.peek_output(CAPACITY) != expected, "peek_output mismatch");
+            }
+        }
+
+        {
+            ByteStream bs{4};
+            bs.write("abcd");
+            bool threw = false;
+            try {
+                bs.commit_write(1);
+            } catch (const out_of_range &) {
+                threw = true;
+            }
+            test_err_if(not threw, "commit_write past the capacity should throw");
+        }
+
+        {
+            ByteStream bs{4};
+            bs.write("ab");
+            bs.end_input();
+            bool threw = false;
+            try {
+                bs.commit_write(1);
+            } catch (const out_of_range &) {
+                threw = true;
+            }
+            test_err_if(not threw, "commit_write after end_input should throw");
+            test_err_if(bs.bytes_written() != 2 or bs.peek_output(4) != "ab", "an ended stream should not change");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+int main() {
+    try {
+        TCPConfig cfg{};
+        cfg.delayed_ack_timeout = 40;
+        auto rd = get_random_generator();
+
+        // every second full-sized in-order segment is ACKed at once
+        {
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_1 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            const uint32_t mss = cfg.max_payload_size;
+            const string d(2 * mss, 'x');
+
+            test_1.send_data(rx_isn + 1, tx_isn + 1, d.cbegin(), d.cbegin() + mss);
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: first segment ACKed immediately");
+            test_1.send_data(rx_isn + 1 + mss, tx_isn + 1, d.cbegin() + mss, d.cend());
+            test_1.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1 + 2 * mss).with_payload_size(0),
+                           "test 1 failed: second segment not ACKed");
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: more than one ACK");
+        }
+
+        // segments smaller than the MSS do not count toward the second segment; the timer ACKs them
+        {
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_6 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+            const uint32_t mss = cfg.max_payload_size;
+            const string d(mss, 'x');
+
+            test_6.send_byte(rx_isn + 1, tx_isn + 1, 'a');
+            test_6.send_byte(rx_isn + 2, tx_isn + 1, 'b');
+            test_6.execute(ExpectNoSegment{}, "test 6 failed: small segments ACKed immediately");
+            test_6.send_data(rx_isn + 3, tx_isn + 1, d.cbegin(), d.cend());
+            test_6.execute(ExpectNoSegment{}, "test 6 failed: one full-sized segment ACKed immediately");
+            test_6.execute(Tick(cfg.delayed_ack_timeout));
+            test_6.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 3 + mss).with_payload_size(0),
+                           "test 6 failed: no ACK after the timer expired");
+        }
+
+        // a lone segment is ACKed when the delayed-ACK timer expires
+        {
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_2 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+
+            test_2.send_byte(rx_isn + 1, tx_isn + 1, 'a');
+            test_2.execute(Tick(cfg.delayed_ack_timeout - 1));
+            test_2.execute(ExpectNoSegment{}, "test 2 failed: ACK sent before the timer expired");
+            test_2.execute(Tick(1));
+            test_2.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 2).with_payload_size(0),
+                           "test 2 failed: no ACK after the timer expired");
+            test_2.execute(Tick(cfg.delayed_ack_timeout));
+            test_2.execute(ExpectNoSegment{}, "test 2 failed: ACK sent twice");
+        }
+
+        // out-of-order data, the segment that fills the hole, and a FIN are ACKed immediately
+        {
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_3 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+
+            test_3.send_byte(rx_isn + 2, tx_isn + 1, 'b');
+            test_3.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 1),
+                           "test 3 failed: out-of-order segment not ACKed");
+            test_3.send_byte(rx_isn + 1, tx_isn + 1, 'a');
+            test_3.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 3),
+                           "test 3 failed: segment filling a hole not ACKed");
+            test_3.send_fin(rx_isn + 3, tx_isn + 1);
+            test_3.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 4), "test 3 failed: FIN not ACKed");
+        }
+
+        // data sent in the meantime carries the delayed ACK
+        {
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_4 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+
+            test_4.send_byte(rx_isn + 1, tx_isn + 1, 'a');
+            test_4.execute(Write{"reply"});
+            test_4.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 2).with_data("reply"),
+                           "test 4 failed: reply did not carry the ACK");
+            test_4.execute(Tick(cfg.delayed_ack_timeout));
+            test_4.execute(ExpectNoSegment{}, "test 4 failed: separate ACK after piggybacked one");
+        }
+
+        // without a timeout every segment is ACKed immediately
+        {
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_5 = TCPTestHarness::in_established(TCPConfig{}, tx_isn, rx_isn);
+
+            test_5.send_byte(rx_isn + 1, tx_isn + 1, 'a');
+            test_5.execute(ExpectOneSegment{}.with_ack(true).with_ackno(rx_isn + 2),
+                           "test 5 failed: ACK delayed by default");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // Nagle: small writes wait while data is unacknowledged, then go out together
+        {
+            TCPConfig cfg{};
+            cfg.nagle = true;
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_1 = TCPTestHarness::in_established(cfg, tx_isn, rx_isn);
+
+            test_1.execute(Write{"a"});
+            test_1.execute(ExpectOneSegment{}.with_data("a"), "test 1 failed: first small write held back");
+            test_1.execute(Write{"b"});
+            test_1.execute(Write{"c"});
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: small write sent with data in flight");
+            test_1.send_ack(rx_isn + 1, tx_isn + 2, 4 * TCPConfig::MAX_PAYLOAD_SIZE);
+            test_1.execute(ExpectOneSegment{}.with_data("bc").with_seqno(tx_isn + 2),
+                           "test 1 failed: held writes not sent together after the ACK");
+
+            // a full-sized segment is never held back
+            test_1.execute(Write{string(TCPConfig::MAX_PAYLOAD_SIZE + 10, 'x')});
+            test_1.execute(ExpectOneSegment{}.with_payload_size(TCPConfig::MAX_PAYLOAD_SIZE),
+                           "test 1 failed: full-sized segment held back");
+            test_1.execute(ExpectNoSegment{}, "test 1 failed: small remainder sent with data in flight");
+
+            // closing the stream sends the remainder with the FIN
+            test_1.execute(Close{});
+            test_1.execute(ExpectOneSegment{}.with_payload_size(10).with_fin(true),
+                           "test 1 failed: remainder not sent on close");
+        }
+
+        // cork: nothing smaller than the MSS goes out until uncork, even with nothing in flight
+        {
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_2 = TCPTestHarness::in_established(TCPConfig{}, tx_isn, rx_isn);
+
+            test_2.execute(Cork{});
+            test_2.execute(Write{"header"});
+            test_2.execute(Write{"body"});
+            test_2.execute(Tick(1));
+            test_2.execute(ExpectNoSegment{}, "test 2 failed: corked data sent");
+            test_2.execute(Uncork{});
+            test_2.execute(ExpectOneSegment{}.with_data("headerbody"), "test 2 failed: uncork did not flush");
+
+            test_2.execute(Write{"next"});
+            test_2.execute(ExpectOneSegment{}.with_data("next"), "test 2 failed: write after uncork held back");
+        }
+
+        // without Nagle, every small write is sent right away
+        {
+            const WrappingInt32 rx_isn(rd()), tx_isn(rd());
+            TCPTestHarness test_3 = TCPTestHarness::in_established(TCPConfig{}, tx_isn, rx_isn);
+
+            test_3.execute(Write{"a"});
+            test_3.execute(ExpectOneSegment{}.with_data("a"));
+            test_3.execute(Write{"b"});
+            test_3.execute(ExpectOneSegment{}.with_data("b"), "test 3 failed: small write held back by default");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
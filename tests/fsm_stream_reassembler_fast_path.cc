@@ -0,0 +1,87 @@
+#include "byte_stream.hh"
+#include "fsm_stream_reassembler_harness.hh"
+#include "stream_reassembler.hh"
+#include "util.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    try {
+        {
+            ReassemblerTestHarness test{65000};
+
+            test.execute(SubmitSegment{"abcd", 0});
+            test.execute(SubmitSegment{"efgh", 4});
+            test.execute(FastPathPushes(2, 0));
+            test.execute(BytesAvailable("abcdefgh"));
+            test.execute(SubmitSegment{"ijkl", 8}.with_eof(true));
+            test.execute(FastPathPushes(3, 0));
+            test.execute(BytesAvailable("ijkl"));
+            test.execute(AtEof{});
+        }
+
+        {
+            ReassemblerTestHarness test{65000};
+
+            test.execute(SubmitSegment{"efgh", 4});
+            test.execute(FastPathPushes(0, 1));
+            test.execute(UnassembledBytes(4));
+            // in order, but something is pending, so the pending bytes must be picked up
+            test.execute(SubmitSegment{"abcd", 0});
+            test.execute(FastPathPushes(0, 2));
+            test.execute(BytesAssembled(8));
+            test.execute(UnassembledBytes(0));
+            // nothing pending anymore, so back to the fast path
+            test.execute(SubmitSegment{"ijkl", 8});
+            test.execute(FastPathPushes(1, 2));
+            test.execute(BytesAvailable("abcdefghijkl"));
+        }
+
+        {
+            ReassemblerTestHarness test{4};
+
+            // the fast path must still respect the capacity
+            test.execute(SubmitSegment{"abcdef", 0});
+            test.execute(FastPathPushes(1, 0));
+            test.execute(BytesAssembled(4));
+            test.execute(BytesAvailable("abcd"));
+            test.execute(SubmitSegment{"ef", 4});
+            test.execute(FastPathPushes(2, 0));
+            test.execute(BytesAvailable("ef"));
+        }
+
+        {
+            ReassemblerTestHarness test{65000};
+
+            // bytes past the end of a finished stream must not reach it, on either path
+            test.execute(SubmitSegment{"abc", 0}.with_eof(true));
+            test.execute(SubmitSegment{"xyz", 3});
+            test.execute(BytesAssembled(3));
+            test.execute(BytesAvailable("abc"));
+            test.execute(AtEof{});
+        }
+
+        {
+            ReassemblerTestHarness test{65000};
+
+            // nor bytes held beyond an eof that arrives later, or past an eof still to be assembled
+            test.execute(SubmitSegment{"efghij", 4});
+            test.execute(SubmitSegment{"cdef", 2}.with_eof(true));
+            test.execute(UnassembledBytes(4));
+            test.execute(SubmitSegment{"klm", 6});
+            test.execute(SubmitSegment{"abcdefghij", 0});
+            test.execute(BytesAssembled(6));
+            test.execute(BytesAvailable("abcdef"));
+            test.execute(UnassembledBytes(0));
+            test.execute(AtEof{});
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -103,6 +103,28 @@ struct UnassembledBytes : public ReassemblerExpectation {
     }
 };
 
+struct FastPathPushes : public ReassemblerExpectation {
+    size_t _fast;
+    size_t _slow;
+
+    FastPathPushes(size_t fast, size_t slow) : _fast(fast), _slow(slow) {}
+    std::string description() const {
+        std::ostringstream ss;
+        ss << "fast-path pushes = " << _fast << ", slow-path pushes = " << _slow;
+        return ss.str();
+    }
+
+    void execute(StreamReassembler &reassembler) const {
+        if (reassembler.fast_path_pushes() != _fast or reassembler.slow_path_pushes() != _slow) {
+            std::ostringstream ss;
+            ss << "The reassembler was expected to have taken the fast path `" << _fast << "` times and the slow path `"
+               << _slow << "` times, but it took them `" << reassembler.fast_path_pushes() << "` and `"
+               << reassembler.slow_path_pushes() << "` times";
+            throw ReassemblerExpectationViolation(ss.str());
+        }
+    }
+};
+
 struct AtEof : public ReassemblerExpectation {
     AtEof() {}
     std::string description() const {
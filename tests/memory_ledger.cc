@@ -0,0 +1,181 @@
+#include "byte_stream.hh"
+#include "memory_ledger.hh"
+#include "stream_reassembler.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_demux.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// take every pending segment of x
+static vector<TCPSegment> take(TCPConnection &x) {
+    vector<TCPSegment> taken;
+    while (not x.segments_out().empty()) {
+        taken.push_back(move(x.segments_out().front()));
+        x.segments_out().pop();
+    }
+    return taken;
+}
+
+// deliver every pending segment of `from` to `to`, and return the last one
+static TCPSegment deliver(TCPConnection &from, TCPConnection &to) {
+    TCPSegment last;
+    for (auto &seg : take(from)) {
+        to.segment_received(seg);
+        last = move(seg);
+    }
+    return last;
+}
+
+int main() {
+    try {
+        MemoryLedger &global = MemoryLedger::global();
+
+        {
+            // the ledger keeps the total and its high watermark, and tells the hook when the level changes
+            MemoryLedger ledger;
+            ledger.charge(100);
+            ledger.charge(50);
+            ledger.release(120);
+            test_err_if(ledger.used() != 30 or ledger.high_watermark() != 150, "the ledger should add up");
+            test_err_if(ledger.reset_high_watermark() != 150 or ledger.high_watermark() != 30,
+                        "reset should start over");
+
+            vector<MemoryPressure> levels;
+            ledger.set_pressure_hook([&](const MemoryPressure level) { levels.push_back(level); });
+            ledger.set_limits(100, 200);
+            test_err_if(ledger.pressure() != MemoryPressure::None or not levels.empty(),
+                        "below the limits is no pressure");
+            ledger.charge(80);
+            ledger.charge(1);
+            test_err_if(ledger.pressure() != MemoryPressure::Moderate, "above the soft limit is moderate pressure");
+            ledger.charge(100);
+            test_err_if(ledger.pressure() != MemoryPressure::Critical, "above the hard limit is critical pressure");
+            ledger.release(200);
+            test_err_if(levels != vector<MemoryPressure>(
+                                      {MemoryPressure::Moderate, MemoryPressure::Critical, MemoryPressure::None}),
+                        "the hook should hear of every change of level, once");
+
+            // a hook that responds by freeing memory changes the level again from within itself
+            levels.clear();
+            ledger.set_pressure_hook([&](const MemoryPressure level) {
+                levels.push_back(level);
+                if (level == MemoryPressure::Critical) {
+                    ledger.release(150);
+                }
+            });
+            ledger.charge(250);
+            test_err_if(ledger.used() != 111 or ledger.pressure() != MemoryPressure::Moderate,
+                        "the hook should be able to release memory");
+            test_err_if(levels != vector<MemoryPressure>({MemoryPressure::Critical, MemoryPressure::Moderate}),
+                        "the hook should hear of the level it caused");
+        }
+
+        {
+            // buffers charge what they hold, and release it when destroyed
+            const size_t base = global.used();
+            {
+                ByteStream ring{1000};
+                test_err_if(global.used() != base, "an unused ring should not be charged");
+                ring.write("abc");
+                test_err_if(global.used() != base + 1024, "the ring should be charged once allocated");
+                // a chunked stream is charged the whole strings its chunks keep alive, not just the unread bytes
+                ByteStream chunked{1000, ByteStream::Storage::Chunked};
+                chunked.write(string(500, 'x'));
+                chunked.pop_output(200);
+                test_err_if(global.used() != base + 1024 + 500, "a partly read chunk should be charged whole");
+                Buffer large{string(2000, 'y')};
+                chunked.write(large);
+                test_err_if(chunked.buffer_size() != 1000 or global.used() != base + 1024 + 500 + 2000,
+                            "a slice of a larger Buffer should be charged the whole Buffer");
+                chunked.pop_output(300);
+                test_err_if(global.used() != base + 1024 + 2000, "a chunk read to the end should be released");
+                StreamReassembler reassembler{100};
+                reassembler.push_substring("out of order", 10, false);
+                test_err_if(global.used() != base + 1024 + 2000 + 100, "the reassembly window should be charged");
+                test_err_if(global.high_watermark() < global.used(), "the high watermark should cover the peak");
+            }
+            test_err_if(global.used() != base, "destroyed buffers should release their charges");
+
+            TCPConnection x{TCPConfig{}}, y{TCPConfig{}};
+            x.connect();
+            deliver(x, y);
+            deliver(y, x);
+            x.write(string(20000, 'x'));
+            deliver(x, y);
+            test_err_if(x.bytes_in_flight() != 20000 or x.buffer_memory_usage() != 20000,
+                        "data in flight should be charged to the sender");
+            test_err_if(global.used() != base + x.buffer_memory_usage() + y.buffer_memory_usage(),
+                        "the ledger should hold what both connections buffer");
+            deliver(y, x);
+            test_err_if(x.buffer_memory_usage() != 0, "acknowledged data should be released");
+        }
+
+        {
+            // under pressure the receive window stops opening, out-of-order data is dropped,
+            // and no new connection is accepted
+            MemoryCharge ballast;
+            ballast.set(1000);
+            TCPConfig cfg;
+            TCPConnection x{cfg}, y{cfg};
+            x.connect();
+            deliver(x, y);
+            deliver(y, x);
+
+            global.set_limits(1, 0);
+            x.write(string(10000, 'x'));
+            deliver(x, y);
+            test_err_if(deliver(y, x).header().win != cfg.recv_capacity - 10000,
+                        "the window should shrink with the data");
+            y.inbound_stream().pop_output(10000);
+            x.write(string(5000, 'x'));
+            deliver(x, y);
+            test_err_if(deliver(y, x).header().win != cfg.recv_capacity - 15000,
+                        "reading the data should not open the window under pressure");
+
+            global.set_limits(0, 1);
+            x.write(string(3 * cfg.max_payload_size, 'x'));
+            const vector<TCPSegment> segments = take(x);
+            y.segment_received(segments[1]);
+            y.segment_received(segments[2]);
+            test_err_if(y.unassembled_bytes() != 0, "out-of-order data should be dropped under critical pressure");
+            y.segment_received(segments[0]);
+            test_err_if(y.inbound_stream().buffer_size() != 5000 + cfg.max_payload_size,
+                        "in-order data should be kept");
+
+            TCPDemux server, client;
+            server.listen(80, cfg);
+            const FourTuple flow{0x0a000002, 1000, 0x0a000001, 80};
+            client.connect(cfg, flow);
+            server.segment_received(flow.reversed(), client.segments_out().front().second);
+            test_err_if(server.size() != 0 or server.refused_syns() != 1, "a new connection should be refused");
+
+            global.set_limits(0, 0);
+            // the sender retransmits what was dropped
+            y.segment_received(segments[1]);
+            y.segment_received(segments[2]);
+            take(y);
+            y.inbound_stream().pop_output(y.inbound_stream().buffer_size());
+            x.write(string(1000, 'x'));
+            deliver(x, y);
+            test_err_if(deliver(y, x).header().win != cfg.recv_capacity - 1000,
+                        "the window should open without pressure");
+            server.segment_received(flow.reversed(), client.segments_out().front().second);
+            test_err_if(server.size() != 1, "connections should be accepted without pressure");
+        }
+    } catch (const exception &e) {
+        MemoryLedger::global().set_limits(0, 0);
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
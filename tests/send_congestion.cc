@@ -0,0 +1,108 @@
+#include "congestion_control.hh"
+#include "sender_harness.hh"
+#include "test_err_if.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        const size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Without congestion control only the receiver window limits sending", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(50000, 'a')});
+            test.execute(ExpectBytesInFlight{50000});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+
+            TCPSenderTestHarness test{"NewReno starts from the initial window and grows in slow start", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(ExpectCongestionWindow{10 * MSS + 1});
+            test.execute(WriteBytes{string(50000, 'a')});
+            test.execute(ExpectBytesInFlight{10 * MSS + 1});
+            test.execute(AckReceived{WrappingInt32{isn + 1 + MSS}}.with_win(60000));
+            test.execute(ExpectCongestionWindow{11 * MSS + 1});
+            test.execute(ExpectBytesInFlight{11 * MSS + 1});
+
+            // a timeout collapses the window to one segment
+            test.execute(Tick{cfg.rt_timeout});
+            test.execute(ExpectCongestionWindow{MSS});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.congestion_control = TCPConfig::CongestionAlgorithm::Cubic;
+
+            TCPSenderTestHarness test{"CUBIC limits the window and collapses it on timeout", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(60000));
+            test.execute(WriteBytes{string(50000, 'a')});
+            test.execute(ExpectBytesInFlight{10 * MSS + 1});
+            test.execute(Tick{cfg.rt_timeout});
+            test.execute(ExpectCongestionWindow{MSS});
+        }
+
+        {
+            // NewReno: halve on loss, then one MSS per window of acknowledged bytes
+            NewReno cc{MSS};
+            cc.on_congestion_event(20 * MSS, 0);
+            test_err_if(cc.cwnd() != 10 * MSS or cc.ssthresh() != 10 * MSS, "NewReno should halve the flight on loss");
+            for (size_t i = 0; i < 10; i++) {
+                cc.on_ack(MSS, 0);
+            }
+            test_err_if(cc.cwnd() != 11 * MSS, "NewReno should grow by one MSS per window in congestion avoidance");
+        }
+
+        {
+            // CUBIC: after a loss the window regrows to about W_max at time K, then beyond it
+            Cubic cc{MSS};
+            cc.on_rtt_sample(10);
+            while (cc.cwnd() < 100 * MSS) {
+                cc.on_ack(MSS, 0);
+            }
+            cc.on_congestion_event(cc.cwnd(), 0);
+            test_err_if(cc.cwnd() != 70 * MSS, "CUBIC should reduce the window by beta on loss");
+
+            // K = cbrt(W_max * (1 - beta) / C) seconds
+            const uint64_t k_ms = 4217;
+            uint64_t now = 0;
+            for (; now < k_ms; now += 10) {
+                cc.on_ack(MSS, now);
+            }
+            test_err_if(cc.cwnd() <= 90 * MSS or cc.cwnd() >= 102 * MSS, "CUBIC should plateau near W_max at time K");
+            for (; now < 10000; now += 10) {
+                cc.on_ack(MSS, now);
+            }
+            test_err_if(cc.cwnd() <= 110 * MSS, "CUBIC should probe beyond W_max after the plateau");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
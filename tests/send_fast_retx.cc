@@ -0,0 +1,134 @@
+#include "sender_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+// SYN, then four one-byte segments "a" "b" "c" "d" (seqnos isn+1 .. isn+4), then "a" is acked
+static void send_four_and_ack_first(TCPSenderTestHarness &test, const WrappingInt32 isn) {
+    test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+    test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+    for (const char *data : {"a", "b", "c", "d"}) {
+        test.execute(WriteBytes{string(data)});
+        test.execute(ExpectSegment{}.with_data(data));
+    }
+    test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000));
+    test.execute(ExpectNoSegment{});
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.fast_retransmit = true;
+
+            TCPSenderTestHarness test{"Third duplicate ACK retransmits the first unacked segment", cfg};
+            send_four_and_ack_first(test, isn);
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000));
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectFastRecovery{false});
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000));
+            test.execute(ExpectSegment{}.with_data("b").with_seqno(isn + 2));
+            test.execute(ExpectFastRecovery{true});
+            // further duplicates do not retransmit again
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000));
+            test.execute(ExpectNoSegment{});
+            // a partial ACK means the next segment was lost too: retransmit it right away
+            test.execute(AckReceived{WrappingInt32{isn + 3}}.with_win(1000));
+            test.execute(ExpectSegment{}.with_data("c").with_seqno(isn + 3));
+            test.execute(ExpectFastRecovery{true});
+            // the ACK that covers everything sent before recovery began ends it
+            test.execute(AckReceived{WrappingInt32{isn + 5}}.with_win(1000));
+            test.execute(ExpectFastRecovery{false});
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectBytesInFlight{0});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+
+            TCPSenderTestHarness test{"Duplicate ACKs are ignored unless fast retransmit is enabled", cfg};
+            send_four_and_ack_first(test, isn);
+            for (int i = 0; i < 4; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000));
+            }
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectFastRecovery{false});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.fast_retransmit = true;
+
+            TCPSenderTestHarness test{"ACKs that change the window are not duplicates", cfg};
+            send_four_and_ack_first(test, isn);
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(999));
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(998));
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(997));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectFastRecovery{false});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            const uint16_t retx_timeout = uniform_int_distribution<uint16_t>{10, 10000}(rd);
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = retx_timeout;
+            cfg.fast_retransmit = true;
+
+            TCPSenderTestHarness test{"Duplicate ACKs for data sent before a timeout do not trigger recovery", cfg};
+            send_four_and_ack_first(test, isn);
+            test.execute(Tick{retx_timeout});
+            test.execute(ExpectSegment{}.with_data("b").with_seqno(isn + 2));
+            for (int i = 0; i < 3; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000));
+            }
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectFastRecovery{false});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.fast_retransmit = true;
+            cfg.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+            const size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+            TCPSenderTestHarness test{"Fast recovery inflates the window by one MSS per duplicate ACK", cfg};
+            send_four_and_ack_first(test, isn);
+            for (int i = 0; i < 3; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000));
+            }
+            test.execute(ExpectSegment{}.with_data("b"));
+            // ssthresh = max(FlightSize / 2, 2 * MSS), cwnd = ssthresh + 3 * MSS
+            test.execute(ExpectCongestionWindow{5 * MSS});
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000));
+            test.execute(ExpectCongestionWindow{6 * MSS});
+            test.execute(AckReceived{WrappingInt32{isn + 5}}.with_win(1000));
+            test.execute(ExpectCongestionWindow{2 * MSS});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
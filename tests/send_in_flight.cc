@@ -0,0 +1,71 @@
+#include "buffer.hh"
+#include "tcp_sender.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        {
+            // entries of 10 sequence numbers each, starting at 1 (after a SYN at 0)
+            InFlightRing ring;
+            ring.push_back({0, 1, true, false, Buffer{}});
+            for (uint64_t seqno = 1; seqno < 1001; seqno += 10) {
+                ring.push_back({seqno, 10, false, false, Buffer{string(10, 'x')}});
+            }
+            test_err_if(ring.size() != 101, "ring should grow past its initial capacity");
+
+            test_err_if(ring.pop_acked(0) != 0, "nothing is acknowledged yet");
+            test_err_if(ring.pop_acked(5) != 1, "only the SYN is fully acknowledged");
+            test_err_if(ring.front().seqno != 1, "the first data entry should be at the front");
+            test_err_if(ring.pop_acked(500) != 490, "entries ending at or below the ackno are popped together");
+            test_err_if(ring.front().seqno != 491 or ring[1].seqno != 501,
+                        "partly acknowledged entry stays at the front");
+            test_err_if(ring.size() != 51, "wrong number of entries left");
+        }
+
+        {
+            // the ring keeps working as entries wrap around its storage
+            InFlightRing ring;
+            uint64_t next = 0;
+            for (int round = 0; round < 100; round++) {
+                for (int i = 0; i < 7; i++) {
+                    ring.push_back({next, 3, false, false, Buffer{}});
+                    next += 3;
+                }
+                // all but the last two entries are acknowledged, including the two left by the previous round
+                test_err_if(ring.pop_acked(next - 6) != (round == 0 ? 15u : 21u), "wrong number of entries popped");
+                test_err_if(ring.size() != 2 or ring.front().seqno != next - 6, "two entries should remain");
+            }
+        }
+
+        {
+            // the sender retransmits the same payload storage it sent, without copying the bytes
+            TCPConfig cfg;
+            cfg.rt_timeout = 100;
+            TCPSender sender{cfg};
+            sender.fill_window();
+            sender.ack_received(WrappingInt32{sender.next_seqno()}, 1000);
+            sender.segments_out().pop();
+            sender.stream_in().write(string(300, 'y'));
+            sender.fill_window();
+            const Buffer sent = sender.segments_out().front().payload();
+            sender.segments_out().pop();
+            sender.tick(100);
+            test_err_if(sender.segments_out().size() != 1, "the segment should be retransmitted");
+            const TCPSegment &retx = sender.segments_out().front();
+            test_err_if(retx.payload().str().data() != sent.str().data(), "retransmission should share the payload");
+            test_err_if(retx.payload().str() != string(300, 'y'), "retransmitted payload is wrong");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
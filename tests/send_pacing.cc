@@ -0,0 +1,88 @@
+#include "tcp_config.hh"
+#include "tcp_sender.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+// connect, with the SYN acknowledged `rtt` ms later to give the first RTT sample
+static void handshake(TCPSender &sender, const size_t rtt, const uint16_t window) {
+    sender.fill_window();
+    sender.segments_out().pop();
+    sender.tick(rtt);
+    sender.ack_received(sender.next_seqno(), window);
+}
+
+static size_t drain(TCPSender &sender) {
+    size_t bytes = 0;
+    while (not sender.segments_out().empty()) {
+        bytes += sender.segments_out().front().length_in_sequence_space();
+        sender.segments_out().pop();
+    }
+    return bytes;
+}
+
+int main() {
+    try {
+        {
+            // a 10000-byte window over a 10 ms RTT is paced at 1.2 * 10000 / 10 = 1200 bytes per ms
+            TCPConfig cfg;
+            cfg.pacing = true;
+            TCPSender sender{cfg};
+            handshake(sender, 10, 10000);
+
+            sender.stream_in().write(string(10000, 'x'));
+            sender.fill_window();
+            test_err_if(drain(sender) != 0, "the token bucket starts empty");
+            test_err_if(sender.pacing_delay() != optional<uint64_t>{1}, "one millisecond of tokens covers a segment");
+
+            sender.tick(1);
+            test_err_if(drain(sender) != 2000, "1200 tokens should let two segments go, overdrawing the bucket");
+            test_err_if(sender.pacing_delay() != optional<uint64_t>{1}, "the overdraft is repaid within a millisecond");
+            size_t sent = 2000;
+            for (size_t ms = 2; ms <= 5; ms++) {
+                sender.tick(1);
+                sent += drain(sender);
+                test_err_if(sent > 1200 * ms + 1000, "pacing let more than the rate through");
+            }
+            test_err_if(sent != 6000, "four more ticks should send one segment each");
+            for (size_t ms = 6; ms <= 9; ms++) {
+                sender.tick(1);
+                sent += drain(sender);
+            }
+            test_err_if(sent != 10000, "the whole window should go out within one RTT");
+            test_err_if(sender.pacing_delay().has_value(), "nothing is waiting for pacing");
+        }
+
+        {
+            // a long gap between ticks allows a correspondingly larger burst
+            TCPConfig cfg;
+            cfg.pacing = true;
+            TCPSender sender{cfg};
+            handshake(sender, 10, 10000);
+            sender.stream_in().write(string(10000, 'x'));
+            sender.tick(5);
+            test_err_if(drain(sender) != 6000, "5 ms of tokens should send 6000 bytes at once");
+        }
+
+        {
+            // without pacing the whole window is sent at once
+            TCPSender sender{TCPConfig{}};
+            handshake(sender, 10, 10000);
+            sender.stream_in().write(string(10000, 'x'));
+            sender.fill_window();
+            test_err_if(drain(sender) != 10000, "the window should be sent in one burst");
+            test_err_if(sender.pacing_delay().has_value(), "pacing is off by default");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+#include "sender_harness.hh"
+#include "test_err_if.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            // first sample: SRTT = R, RTTVAR = R/2; later samples are smoothed with alpha = 1/8, beta = 1/4
+            RTTEstimator est{1, 60000};
+            test_err_if(est.has_sample() or est.srtt() != 0, "no SRTT before the first sample");
+            est.add_sample(100);
+            test_err_if(est.srtt() != 100 or est.RTO() != 300, "first sample should give RTO = 3 * RTT");
+            est.add_sample(20);
+            test_err_if(est.srtt() != 90 or est.RTO() != 90 + 4 * 57.5, "second sample smoothed incorrectly");
+
+            RTTEstimator clamped{200, 1000};
+            clamped.add_sample(10);
+            test_err_if(clamped.RTO() != 200, "RTO should be clamped from below");
+            clamped.add_sample(5000);
+            test_err_if(clamped.RTO() != 1000, "RTO should be clamped from above");
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.adaptive_rto = true;
+            cfg.min_rto = 10;
+
+            TCPSenderTestHarness test{"Adaptive RTO follows the measured RTT", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(Tick{20});
+            test.execute(AckReceived{WrappingInt32{isn + 1}});
+            // SRTT = 20, RTTVAR = 10, so RTO = 20 + 4 * 10
+            test.execute(WriteBytes{"abc"});
+            test.execute(ExpectSegment{}.with_data("abc"));
+            test.execute(Tick{59});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("abc"));
+            // exponential backoff still applies
+            test.execute(Tick{119});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("abc"));
+            // Karn: the ACK of a retransmitted segment is not a sample, so the RTO returns to 60
+            test.execute(AckReceived{WrappingInt32{isn + 4}});
+            test.execute(WriteBytes{"def"});
+            test.execute(ExpectSegment{}.with_data("def"));
+            test.execute(Tick{59});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("def"));
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.adaptive_rto = true;
+            cfg.rt_timeout = 1000;
+            cfg.max_rto = 3000;
+
+            TCPSenderTestHarness test{"Adaptive RTO backoff is capped by max_rto", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(Tick{1000});
+            test.execute(ExpectSegment{}.with_syn(true));
+            test.execute(Tick{2000});
+            test.execute(ExpectSegment{}.with_syn(true));
+            test.execute(Tick{2999});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_syn(true));
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.rt_timeout = 1000;
+
+            TCPSenderTestHarness test{"Without adaptive RTO the measured RTT does not change the timeout", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(Tick{20});
+            test.execute(AckReceived{WrappingInt32{isn + 1}});
+            test.execute(WriteBytes{"abc"});
+            test.execute(ExpectSegment{}.with_data("abc"));
+            test.execute(Tick{999});
+            test.execute(ExpectNoSegment{});
+            test.execute(Tick{1});
+            test.execute(ExpectSegment{}.with_data("abc"));
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    return EXIT_SUCCESS;
+}
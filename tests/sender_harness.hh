@@ -15,6 +15,7 @@
 #include <optional>
 #include <sstream>
 #include <string>
+#include <vector>
 
 const unsigned int DEFAULT_TEST_WINDOW = 137;
 
@@ -99,6 +100,36 @@ struct ExpectBytesInFlight : public SenderExpectation {
     }
 };
 
+struct ExpectCongestionWindow : public SenderExpectation {
+    size_t _cwnd;
+
+    ExpectCongestionWindow(size_t cwnd) : _cwnd(cwnd) {}
+    std::string description() const { return "congestion window of " + std::to_string(_cwnd) + " bytes"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.congestion_window() != _cwnd) {
+            std::ostringstream ss;
+            ss << "The TCPSender reported a congestion window of " << sender.congestion_window()
+               << " bytes, but it was expected to be " << _cwnd << " bytes";
+            throw SenderExpectationViolation(ss.str());
+        }
+    }
+};
+
+struct ExpectFastRecovery : public SenderExpectation {
+    bool _in_recovery;
+
+    ExpectFastRecovery(bool in_recovery) : _in_recovery(in_recovery) {}
+    std::string description() const { return _in_recovery ? "in fast recovery" : "not in fast recovery"; }
+
+    void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
+        if (sender.in_fast_recovery() != _in_recovery) {
+            throw SenderExpectationViolation(std::string("The TCPSender should ") + (_in_recovery ? "" : "not ") +
+                                             "have been in fast recovery");
+        }
+    }
+};
+
 struct ExpectNoSegment : public SenderExpectation {
     ExpectNoSegment() {}
     std::string description() const { return "no (more) segments"; }
@@ -191,11 +222,15 @@ struct Tick : public SenderAction {
 struct AckReceived : public SenderAction {
     WrappingInt32 _ackno;
     std::optional<uint16_t> _window_advertisement{};
+    std::vector<SACKBlock> _sack{};
 
     AckReceived(WrappingInt32 ackno) : _ackno(ackno) {}
     std::string description() const {
         std::ostringstream ss;
         ss << "ack " << _ackno.raw_value() << " winsize " << _window_advertisement.value_or(DEFAULT_TEST_WINDOW);
+        for (const auto &block : _sack) {
+            ss << " sack " << block.left.raw_value() << "-" << block.right.raw_value();
+        }
         return ss.str();
     }
 
@@ -204,8 +239,13 @@ struct AckReceived : public SenderAction {
         return *this;
     }
 
+    AckReceived &with_sack(const WrappingInt32 left, const WrappingInt32 right) {
+        _sack.push_back({left, right});
+        return *this;
+    }
+
     void execute(TCPSender &sender, std::queue<TCPSegment> &) const {
-        sender.ack_received(_ackno, _window_advertisement.value_or(DEFAULT_TEST_WINDOW));
+        sender.ack_received(_ackno, _window_advertisement.value_or(DEFAULT_TEST_WINDOW), false, _sack);
         sender.fill_window();
     }
 };
@@ -394,7 +434,7 @@ class TCPSenderTestHarness {
   public:
     TCPSenderTestHarness(const std::string &name_, TCPConfig config)
         : outbound_segments()
-        , sender(config.send_capacity, config.rt_timeout, config.fixed_isn)
+        , sender(config)
         , steps_executed()
         , name(name_) {
         sender.fill_window();
@@ -0,0 +1,113 @@
+#include "byte_stream.hh"
+#include "stream_reassembler.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// deliver every pending segment of `from` to `to`
+static void deliver(TCPConnection &from, TCPConnection &to) {
+    while (not from.segments_out().empty()) {
+        to.segment_received(from.segments_out().front());
+        from.segments_out().pop();
+    }
+}
+
+int main() {
+    try {
+        {
+            // a ring stream keeps its bytes, in order, as it is resized while they wrap around the ring
+            ByteStream stream{16};
+            test_err_if(stream.memory_usage() != 0, "the ring should be allocated on the first write");
+            stream.write("0123456789");
+            stream.pop_output(8);
+            stream.write("abcdefghijkl");
+            stream.set_capacity(100);
+            test_err_if(stream.capacity() != 100 or stream.remaining_capacity() != 86, "the stream should have grown");
+            test_err_if(stream.peek_output(100) != "89abcdefghijkl", "growing should keep the buffered bytes");
+            stream.set_capacity(4);
+            test_err_if(stream.capacity() != 14, "the stream should not shrink below what it buffers");
+            test_err_if(stream.read(100) != "89abcdefghijkl", "shrinking should keep the buffered bytes");
+            stream.release_memory();
+            test_err_if(stream.memory_usage() != 0, "an empty stream should free its ring");
+            stream.write("again");
+            test_err_if(stream.read(100) != "again" or stream.memory_usage() != 16, "the ring should come back");
+        }
+
+        {
+            // out-of-order data survives the window growing, and is assembled afterwards
+            StreamReassembler reassembler{10};
+            reassembler.push_substring("ghij", 6, false);
+            reassembler.push_substring("cd", 2, false);
+            reassembler.grow_capacity(25);
+            reassembler.push_substring("klmnopqrstuvwxy", 10, true);
+            reassembler.push_substring("ab", 0, false);
+            reassembler.push_substring("ef", 4, false);
+            test_err_if(reassembler.stream_out().read(100) != "abcdefghijklmnopqrstuvwxy" or
+                            not reassembler.stream_out().eof(),
+                        "the reassembled stream is wrong");
+            reassembler.release_memory();
+            test_err_if(reassembler.memory_usage() != 0, "an empty reassembler should free its memory");
+        }
+
+        {
+            // a window-limited transfer grows both buffers up to the limits, and an idle connection shrinks them
+            TCPConfig cfg;
+            cfg.window_scaling = true;
+            cfg.buffer_autotuning = true;
+            cfg.send_capacity_max = cfg.recv_capacity_max = 1024 * 1024;
+            TCPConnection x{cfg}, y{cfg};
+            x.connect();
+            deliver(x, y);
+            deliver(y, x);
+            test_err_if(x.send_capacity() != 2 * cfg.recv_capacity, "the send buffer should hold two peer windows");
+
+            for (int round = 0; round < 20; round++) {
+                x.write(string(x.remaining_outbound_capacity(), 'x'));
+                deliver(x, y);
+                y.inbound_stream().pop_output(y.inbound_stream().buffer_size());
+                x.tick(1);
+                y.tick(1);
+                deliver(y, x);
+            }
+            test_err_if(y.receive_capacity() != cfg.recv_capacity_max, "the receive buffer should reach its limit");
+            test_err_if(x.send_capacity() != cfg.send_capacity_max, "the send buffer should reach its limit");
+            test_err_if(x.receive_capacity() != cfg.recv_capacity, "a receiver that gets nothing should not grow");
+
+            // let the transfer drain, then stay idle for an RTO
+            while (not x.segments_out().empty()) {
+                deliver(x, y);
+                y.inbound_stream().pop_output(y.inbound_stream().buffer_size());
+                deliver(y, x);
+            }
+            test_err_if(x.bytes_in_flight() != 0 or y.buffer_memory_usage() == 0, "the transfer should be done");
+            test_err_if(not y.next_timeout().has_value() or y.next_timeout().value() > TCPConfig::TIMEOUT_DFLT,
+                        "an idle connection should wake up to shrink its buffers");
+            x.tick(TCPConfig::TIMEOUT_DFLT);
+            y.tick(TCPConfig::TIMEOUT_DFLT);
+            test_err_if(x.send_capacity() != cfg.send_capacity,
+                        "an idle send buffer should go back to its configured size");
+            test_err_if(y.buffer_memory_usage() != 0, "an idle receiver should free its buffers");
+            test_err_if(y.receive_capacity() != cfg.recv_capacity_max, "the receive window should never retreat");
+            test_err_if(y.next_timeout().has_value(), "nothing should be left to do");
+
+            // the next transfer allocates the buffers again
+            x.write(string(5000, 'y'));
+            deliver(x, y);
+            test_err_if(y.inbound_stream().read(5000) != string(5000, 'y'),
+                        "data should flow after the buffers shrank");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
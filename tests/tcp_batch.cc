@@ -0,0 +1,82 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// take every pending segment of x
+static vector<TCPSegment> take(TCPConnection &x) {
+    vector<TCPSegment> taken;
+    while (not x.segments_out().empty()) {
+        taken.push_back(move(x.segments_out().front()));
+        x.segments_out().pop();
+    }
+    return taken;
+}
+
+int main() {
+    try {
+        TCPConfig cfg;
+        cfg.send_capacity = cfg.recv_capacity = 64000;
+        cfg.fast_retransmit = true;
+
+        // a handshake delivered in batches of one works as with segment_received
+        TCPConnection x{cfg}, y{cfg};
+        x.connect();
+        y.segments_received(take(x));
+        x.segments_received(take(y));
+        y.segments_received(take(x));
+        test_err_if(x.state() != TCPState::State::ESTABLISHED or y.state() != TCPState::State::ESTABLISHED,
+                    "the handshake should complete");
+
+        // ten segments one by one are answered with ten ACKs
+        x.write(string(10 * cfg.max_payload_size, 'a'));
+        const vector<TCPSegment> one_by_one = take(x);
+        test_err_if(one_by_one.size() != 10, "the data should go out as ten segments");
+        for (const auto &seg : one_by_one) {
+            y.segment_received(seg);
+        }
+        test_err_if(take(y).size() != 10, "every segment should be ACKed on its own");
+
+        // the same in one batch get a single ACK, for all of it
+        x.write(string(10 * cfg.max_payload_size, 'b'));
+        const vector<TCPSegment> batch = take(x);
+        y.segments_received(batch);
+        const vector<TCPSegment> acks = take(y);
+        test_err_if(acks.size() != 1, "a batch should be answered with one ACK");
+        const WrappingInt32 batch_end = batch.back().header().seqno + batch.back().length_in_sequence_space();
+        test_err_if(acks.front().header().ackno != batch_end, "the ACK should cover the whole batch");
+        test_err_if(y.inbound_stream().buffer_size() != 20 * cfg.max_payload_size, "all the data should arrive");
+
+        // with the first segment lost, each of the rest is out of order and gets its own duplicate ACK,
+        // enough for the sender to retransmit fast
+        x.write(string(10 * cfg.max_payload_size, 'c'));
+        const vector<TCPSegment> lossy = take(x);
+        y.segments_received(vector<TCPSegment>(lossy.begin() + 1, lossy.end()));
+        const vector<TCPSegment> dup_acks = take(y);
+        test_err_if(dup_acks.size() != 9, "every out-of-order segment should be ACKed on its own");
+        for (const auto &ack : dup_acks) {
+            test_err_if(ack.header().ackno != lossy.front().header().seqno,
+                        "the ACKs should all ask for the lost segment");
+        }
+        x.segments_received(dup_acks);
+        const vector<TCPSegment> retransmitted = take(x);
+        test_err_if(x.fast_retransmits() != 1 or retransmitted.empty() or
+                        retransmitted.front().header().seqno != lossy.front().header().seqno,
+                    "the duplicate ACKs should trigger a fast retransmit of the lost segment");
+        y.segments_received(retransmitted);
+        test_err_if(y.inbound_stream().buffer_size() != 30 * cfg.max_payload_size, "the lost data should be repaired");
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
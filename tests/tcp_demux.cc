@@ -0,0 +1,204 @@
+#include "fd_adapter.hh"
+#include "flow_table.hh"
+#include "socket.hh"
+#include "tcp_config.hh"
+#include "tcp_demux.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// deliver segments between two TCPDemuxes until neither has anything left to send
+static void exchange(TCPDemux &a, TCPDemux &b) {
+    while (not a.segments_out().empty() or not b.segments_out().empty()) {
+        for (auto [from, to] : {make_pair(&a, &b), make_pair(&b, &a)}) {
+            while (not from->segments_out().empty()) {
+                auto [flow, seg] = move(from->segments_out().front());
+                from->segments_out().pop();
+                to->segment_received(flow.reversed(), seg);
+            }
+        }
+    }
+}
+
+static FourTuple client_flow(const uint16_t port) { return {0x0a000002, port, 0x0a000001, 80}; }
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            // the table finds what was inserted, and keeps finding the rest as entries are erased
+            FlowTable<int> table;
+            vector<FourTuple> keys;
+            for (int i = 0; i < 5000; i++) {
+                keys.push_back({static_cast<uint32_t>(rd()), static_cast<uint16_t>(rd()), 0x0a000001, 80});
+                table.insert(keys.back(), i);
+            }
+            test_err_if(table.size() != 5000, "every key should be stored once");
+            for (int i = 0; i < 5000; i++) {
+                test_err_if(table.find(keys[i]) == nullptr or *table.find(keys[i]) != i, "inserted key not found");
+            }
+            for (int i = 0; i < 5000; i += 2) {
+                test_err_if(not table.erase(keys[i]), "erase should find the key");
+            }
+            test_err_if(table.size() != 2500 or table.erase(keys[0]), "erased keys should be gone");
+            for (int i = 0; i < 5000; i++) {
+                test_err_if((table.find(keys[i]) == nullptr) != (i % 2 == 0), "erase disturbed another key");
+            }
+        }
+
+        {
+            // a listener accepts connections up to its backlog; each connection gets its own data
+            TCPDemux server, client;
+            server.listen(80, TCPConfig{}, 2);
+            for (uint16_t port = 1000; port < 1003; port++) {
+                client.connect(TCPConfig{}, client_flow(port));
+            }
+            exchange(client, server);
+            test_err_if(server.size() != 2, "the SYN beyond the backlog should be dropped");
+            const auto first = server.accept(), second = server.accept();
+            test_err_if(not first.has_value() or not second.has_value() or server.accept().has_value(),
+                        "two handshakes should be ready to accept");
+            test_err_if(first.value() != client_flow(1000).reversed(), "connections should be accepted in order");
+
+            // accepting made room: the retransmitted SYN gets in
+            client.tick(TCPConfig::TIMEOUT_DFLT);
+            exchange(client, server);
+            test_err_if(server.accept() != client_flow(1002).reversed(), "retransmitted SYN should be accepted");
+
+            client.write(client_flow(1000), Buffer{string("first")});
+            client.write(client_flow(1001), Buffer{string("second")});
+            exchange(client, server);
+            test_err_if(server.read(client_flow(1000).reversed(), 100) != "first", "data went astray");
+            test_err_if(server.read(client_flow(1001).reversed(), 100) != "second", "data went astray");
+
+            // closed connections are removed once both ends are done
+            for (uint16_t port = 1000; port < 1003; port++) {
+                client.end_input_stream(client_flow(port));
+            }
+            exchange(client, server);
+            for (uint16_t port = 1000; port < 1003; port++) {
+                server.end_input_stream(client_flow(port).reversed());
+            }
+            exchange(client, server);
+            server.tick(1);
+            test_err_if(server.size() != 0, "the passive closer should be removed right away");
+            test_err_if(client.size() != 3, "the active closer should linger");
+            client.tick(10 * TCPConfig::TIMEOUT_DFLT);
+            test_err_if(client.size() != 0, "the active closer should be removed after lingering");
+        }
+
+        {
+            // a connection that closed with unread data has no timer, and is removed once the data is read
+            TCPDemux server, client;
+            server.listen(80, TCPConfig{});
+            const FourTuple flow = client_flow(3000);
+            client.connect(TCPConfig{}, flow);
+            exchange(client, server);
+            test_err_if(server.accept() != flow.reversed(), "the connection should be accepted");
+            client.write(flow, Buffer{string("unread")});
+            client.end_input_stream(flow);
+            exchange(client, server);
+            server.end_input_stream(flow.reversed());
+            exchange(client, server);
+            server.tick(1);
+            test_err_if(server.connection(flow.reversed()).active(), "the connection should have closed");
+
+            // let any timer set before the close fire; after that nothing is scheduled
+            server.tick(10 * TCPConfig::TIMEOUT_DFLT);
+            test_err_if(server.pending_timers() != 0, "a closed connection should schedule no timers");
+            server.tick(10 * TCPConfig::TIMEOUT_DFLT);
+            test_err_if(server.pending_timers() != 0 or server.size() != 1,
+                        "a closed connection with unread data should stay, without timers");
+            test_err_if(server.read(flow.reversed(), 3) != "unr" or server.size() != 1,
+                        "a closed connection should stay until all of its data is read");
+            test_err_if(server.read(flow.reversed(), 100) != "ead" or server.size() != 0,
+                        "a closed connection should be removed once its data is read");
+        }
+
+        {
+            // a segment for no connection is answered with a RST
+            TCPDemux server;
+            TCPSegment stray;
+            stray.header().ack = true;
+            stray.header().ackno = WrappingInt32{12345};
+            server.segment_received(client_flow(2000).reversed(), stray);
+            test_err_if(server.segments_out().size() != 1, "a stray segment should be answered");
+            const TCPHeader &rst = server.segments_out().front().second.header();
+            test_err_if(not rst.rst or rst.seqno != WrappingInt32{12345},
+                        "the RST should take the stray segment's ackno");
+            test_err_if(server.size() != 0, "a stray segment should not create a connection");
+        }
+
+        {
+            // one event loop serving many connections, over UDP on the loopback interface
+            // (over UDP the UDP ports are the connection's ports, so each client needs its own socket)
+            constexpr size_t connections = 100;
+            UDPSocket server_sock;
+            server_sock.bind(Address("127.0.0.1", 0));
+            const Address server_address = server_sock.local_address();
+            TCPOverUDPDemuxLoop server{TCPOverUDPSocketAdapter{move(server_sock)}};
+            server.adapter().config_mut().source = server_address;
+            server.demux().listen(server_address.ipv4_port(), TCPConfig{}, connections);
+
+            vector<unique_ptr<TCPOverUDPDemuxLoop>> clients;
+            vector<FourTuple> flows;
+            for (size_t i = 0; i < connections; i++) {
+                UDPSocket sock;
+                sock.bind(Address("127.0.0.1", 0));
+                const Address address = sock.local_address();
+                clients.push_back(make_unique<TCPOverUDPDemuxLoop>(TCPOverUDPSocketAdapter{move(sock)}));
+                clients.back()->adapter().config_mut().source = address;
+                flows.push_back({address.ipv4_numeric(),
+                                 address.ipv4_port(),
+                                 server_address.ipv4_numeric(),
+                                 server_address.ipv4_port()});
+                clients.back()->demux().connect(TCPConfig{}, flows.back());
+                clients.back()->demux().write(flows.back(), Buffer{"request " + to_string(i)});
+            }
+
+            vector<FourTuple> accepted;
+            vector<string> replies(connections);
+            size_t answered = 0;
+            for (int round = 0; round < 1000 and answered < connections; round++) {
+                for (auto &client : clients) {
+                    client->wait_next_event(0);
+                }
+                server.wait_next_event(1);
+                while (const auto flow = server.demux().accept()) {
+                    accepted.push_back(flow.value());
+                }
+                for (const auto &flow : accepted) {
+                    if (server.demux().inbound_stream(flow).buffer_size() > 0) {
+                        server.demux().write(flow, Buffer{"reply to " + server.demux().read(flow, 100)});
+                    }
+                }
+                for (size_t i = 0; i < connections; i++) {
+                    if (clients[i]->demux().inbound_stream(flows[i]).buffer_size() > 0) {
+                        replies[i] = clients[i]->demux().read(flows[i], 100);
+                        answered++;
+                    }
+                }
+            }
+            test_err_if(answered != connections, "every connection should get its reply");
+            for (size_t i = 0; i < connections; i++) {
+                test_err_if(replies[i] != "reply to request " + to_string(i), "a reply went to the wrong connection");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
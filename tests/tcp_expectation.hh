@@ -564,4 +564,14 @@ struct Close : public TCPAction {
     void execute(TCPTestHarness &harness) const { harness._fsm.end_input_stream(); }
 };
 
+struct Cork : public TCPAction {
+    std::string description() const { return "cork"; }
+    void execute(TCPTestHarness &harness) const { harness._fsm.cork(); }
+};
+
+struct Uncork : public TCPAction {
+    std::string description() const { return "uncork"; }
+    void execute(TCPTestHarness &harness) const { harness._fsm.uncork(); }
+};
+
 #endif  // SPONGE_LIBSPONGE_TCP_EXPECTATION_HH
@@ -0,0 +1,135 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static TCPSegment data_segment(const WrappingInt32 seqno, const WrappingInt32 ackno, const string &data) {
+    TCPSegment seg;
+    seg.header().seqno = seqno;
+    seg.header().ack = true;
+    seg.header().ackno = ackno;
+    seg.header().win = 1000;
+    seg.payload() = Buffer{string(data)};
+    return seg;
+}
+
+static string payload_of(const TCPSegment &seg) {
+    string payload{seg.payload().str()};
+    for (const auto &frag : seg.frags()) {
+        payload.append(frag.str());
+    }
+    return payload;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            // contiguous data segments with the same ACK merge; a gap, a new ACK or a pure ACK ends the run
+            const WrappingInt32 seqno{static_cast<uint32_t>(rd())}, ackno{static_cast<uint32_t>(rd())};
+            vector<TCPSegment> segments;
+            segments.push_back(data_segment(seqno, ackno, "abc"));
+            segments.push_back(data_segment(seqno + 3, ackno, "def"));
+            segments.push_back(data_segment(seqno + 6, ackno, "gh"));
+            segments.back().header().win = 2000;
+            segments.back().header().fin = true;
+            segments.push_back(data_segment(seqno + 9, ackno, "xyz"));
+            segments.push_back(data_segment(seqno + 12, ackno + 1, "uvw"));
+            segments.push_back(data_segment(seqno + 15, ackno + 1, ""));
+            segments.push_back(data_segment(seqno + 15, ackno + 1, ""));
+
+            const char *const second_payload = segments[1].payload().str().data();
+            const vector<TCPSegment> merged = TCPSegment::coalesce(move(segments));
+            test_err_if(merged.size() != 5, "expected five segments after coalescing, got " + to_string(merged.size()));
+            test_err_if(payload_of(merged[0]) != "abcdefgh" or merged[0].header().seqno != seqno,
+                        "first run should merge into one segment at the first seqno");
+            test_err_if(merged[0].payload_size() != 8 or merged[0].length_in_sequence_space() != 9,
+                        "the chained payloads should count toward the length");
+            test_err_if(merged[0].frags().size() != 2 or merged[0].frags()[0].str().data() != second_payload,
+                        "the later payloads should be chained, not copied");
+            test_err_if(not merged[0].header().fin or merged[0].header().win != 2000,
+                        "the last header's FIN and window apply");
+            test_err_if(merged[1].payload().str() != "xyz", "nothing continues after a FIN");
+            test_err_if(merged[2].payload().str() != "uvw", "a different ackno starts a new run");
+            test_err_if(merged[3].payload().size() != 0 or merged[4].payload().size() != 0, "pure ACKs stay separate");
+        }
+
+        {
+            // segments merge only if they carry the same timestamps, or none
+            const WrappingInt32 seqno{static_cast<uint32_t>(rd())}, ackno{static_cast<uint32_t>(rd())};
+            vector<TCPSegment> segments;
+            for (uint32_t i = 0; i < 5; i++) {
+                segments.push_back(data_segment(seqno + 3 * i, ackno, "abc"));
+            }
+            segments[0].header().timestamps = TCPTimestamps{100, 7};
+            segments[1].header().timestamps = TCPTimestamps{100, 7};
+            segments[2].header().timestamps = TCPTimestamps{101, 7};
+            segments[3].header().timestamps = TCPTimestamps{101, 8};
+
+            const vector<TCPSegment> merged = TCPSegment::coalesce(move(segments));
+            test_err_if(merged.size() != 4, "expected four segments after coalescing, got " + to_string(merged.size()));
+            test_err_if(payload_of(merged[0]) != "abcabc" or merged[0].header().timestamps->tsval != 100,
+                        "segments with the same timestamps should merge");
+            test_err_if(merged[1].header().timestamps->tsval != 101, "a new tsval starts a new run");
+            test_err_if(merged[2].header().timestamps->tsecr != 8, "a new tsecr starts a new run");
+            test_err_if(merged[3].header().timestamps.has_value(), "a segment without timestamps starts a new run");
+        }
+
+        {
+            // runs are capped at MAX_COALESCED_PAYLOAD_SIZE
+            const WrappingInt32 seqno{static_cast<uint32_t>(rd())}, ackno{static_cast<uint32_t>(rd())};
+            vector<TCPSegment> segments;
+            for (uint32_t i = 0; i < 100; i++) {
+                segments.push_back(data_segment(seqno + 1000 * i, ackno, string(1000, 'x')));
+            }
+            const vector<TCPSegment> merged = TCPSegment::coalesce(move(segments));
+            test_err_if(merged.size() != 2 or merged[0].payload_size() != 65000, "runs should stop at 64 KiB");
+            test_err_if(merged[1].header().seqno != seqno + 65000 or merged[1].payload_size() != 35000,
+                        "the rest should make a second segment");
+        }
+
+        {
+            // a coalesced burst is ACKed with a single segment, even with delayed ACKs
+            TCPConfig cfg;
+            cfg.delayed_ack_timeout = 40;
+            TCPConnection x{cfg}, y{cfg};
+            x.connect();
+            y.segment_received(x.segments_out().front());
+            x.segments_out().pop();
+            x.segment_received(y.segments_out().front());
+            y.segments_out().pop();
+            y.segment_received(x.segments_out().front());
+            x.segments_out().pop();
+
+            x.write(string(5000, 'x'));
+            vector<TCPSegment> burst;
+            while (not x.segments_out().empty()) {
+                burst.push_back(x.segments_out().front());
+                x.segments_out().pop();
+            }
+            test_err_if(burst.size() != 5, "five segments should be in the burst");
+            for (auto &seg : TCPSegment::coalesce(move(burst))) {
+                y.segment_received(seg);
+            }
+            test_err_if(y.segments_out().size() != 1, "the burst should be ACKed once");
+            x.segment_received(y.segments_out().front());
+            test_err_if(x.bytes_in_flight() != 0, "the single ACK should cover the whole burst");
+            test_err_if(y.inbound_stream().read(5000) != string(5000, 'x'), "the data should arrive intact");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+#include "tcp_config.hh"
+#include "tcp_segment.hh"
+#include "tcp_sender.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            // a super-segment splits into MSS-sized pieces that share its header and payload storage
+            const WrappingInt32 seqno{static_cast<uint32_t>(rd())};
+            TCPSegment seg;
+            seg.header().seqno = seqno;
+            seg.header().ack = true;
+            seg.header().ackno = WrappingInt32{12345};
+            seg.header().fin = true;
+            seg.payload() = Buffer{string(2500, 'g')};
+            seg.gso_size() = 1000;
+
+            const vector<TCPSegment> pieces = seg.gso_split();
+            test_err_if(pieces.size() != 3, "2500 bytes should make three pieces");
+            for (size_t i = 0; i < pieces.size(); i++) {
+                const TCPHeader &header = pieces[i].header();
+                test_err_if(header.seqno != seqno + 1000 * i, "wrong seqno for piece " + to_string(i));
+                test_err_if(not header.ack or header.ackno != WrappingInt32{12345}, "the ACK is copied to every piece");
+                test_err_if(header.fin != (i == 2), "only the last piece carries the FIN");
+                test_err_if(pieces[i].payload().size() != (i == 2 ? 500u : 1000u),
+                            "wrong size for piece " + to_string(i));
+                test_err_if(pieces[i].payload().str().data() != seg.payload().str().data() + 1000 * i,
+                            "pieces should share the payload storage");
+                test_err_if(pieces[i].gso_size() != 0, "pieces are regular segments");
+
+                TCPSegment parsed;
+                test_err_if(parsed.parse(pieces[i].serialize().concatenate()) != ParseResult::NoError,
+                            "each piece should serialize with a valid checksum");
+            }
+
+            seg.header().syn = true;
+            seg.header().mss = 1000;
+            seg.header().wscale = 7;
+            seg.header().sack_permitted = true;
+            const vector<TCPSegment> syn_pieces = seg.gso_split();
+            test_err_if(not syn_pieces[0].header().syn or syn_pieces[1].header().syn,
+                        "only the first piece has the SYN");
+            test_err_if(syn_pieces[1].header().seqno != seqno + 1001, "the SYN takes one sequence number");
+            test_err_if(syn_pieces[0].header().mss != 1000 or syn_pieces[0].header().wscale != 7 or
+                            not syn_pieces[0].header().sack_permitted,
+                        "the first piece keeps the SYN options");
+            for (size_t i = 1; i < syn_pieces.size(); i++) {
+                const TCPHeader &header = syn_pieces[i].header();
+                test_err_if(header.mss.has_value() or header.wscale.has_value() or header.sack_permitted,
+                            "only the first piece carries the SYN options");
+            }
+
+            seg.gso_size() = 0;
+            test_err_if(seg.gso_split().size() != 1, "a regular segment is not split");
+        }
+
+        {
+            // the sender emits one super-segment per window, and on a timeout retransmits one MSS of it,
+            // from the first unacknowledged byte
+            TCPConfig cfg;
+            cfg.gso = true;
+            cfg.rt_timeout = 100;
+            TCPSender sender{cfg};
+            sender.fill_window();
+            sender.segments_out().pop();
+            sender.ack_received(sender.next_seqno(), 10000);
+
+            sender.stream_in().write(string(10000, 'x'));
+            sender.fill_window();
+            test_err_if(sender.segments_out().size() != 1, "the whole window should go in one super-segment");
+            const TCPSegment &super = sender.segments_out().front();
+            test_err_if(super.payload().size() != 10000 or super.gso_size() != TCPConfig::MAX_PAYLOAD_SIZE,
+                        "super-segment should carry 10000 bytes to be split at the MSS");
+            const WrappingInt32 start = super.header().seqno;
+            sender.segments_out().pop();
+
+            sender.ack_received(start + 4500, 10000);
+            test_err_if(sender.bytes_in_flight() != 5500, "part of the super-segment was acknowledged");
+            sender.tick(100);
+            test_err_if(sender.segments_out().size() != 1, "the retransmission timer should fire");
+            const TCPSegment &retx = sender.segments_out().front();
+            test_err_if(retx.header().seqno != start + 4500 or retx.payload().size() != TCPConfig::MAX_PAYLOAD_SIZE,
+                        "one MSS from the first unacknowledged byte should be retransmitted");
+            test_err_if(retx.gso_size() != 0, "the retransmission is a regular segment");
+        }
+
+        {
+            // a fast retransmit sends one MSS, and SACK repair resends only the holes, one MSS at a time
+            TCPConfig cfg;
+            cfg.gso = true;
+            cfg.sack = true;
+            TCPSender sender{cfg};
+            sender.fill_window();
+            sender.segments_out().pop();
+            sender.ack_received(sender.next_seqno(), 10000);
+
+            sender.stream_in().write(string(10000, 'x'));
+            sender.fill_window();
+            const WrappingInt32 start = sender.segments_out().front().header().seqno;
+            sender.segments_out().pop();
+
+            // the first and third pieces were lost
+            sender.ack_received(start, 10000, false, {{start + 1000, start + 2000}, {start + 3000, start + 10000}});
+            test_err_if(sender.fast_retransmits() != 1, "the SACKed bytes should trigger a fast retransmit");
+            vector<TCPSegment> retx;
+            while (not sender.segments_out().empty()) {
+                retx.push_back(sender.segments_out().front());
+                sender.segments_out().pop();
+            }
+            test_err_if(retx.size() != 2, "only the two holes should be retransmitted, got " + to_string(retx.size()));
+            test_err_if(retx[0].header().seqno != start or retx[1].header().seqno != start + 2000,
+                        "the holes should be retransmitted in order");
+            for (const auto &seg : retx) {
+                test_err_if(seg.payload().size() != TCPConfig::MAX_PAYLOAD_SIZE or seg.gso_size() != 0,
+                            "each hole should be retransmitted as one MSS");
+            }
+        }
+
+        {
+            // without GSO every segment is at most one MSS
+            TCPSender sender{TCPConfig{}};
+            sender.fill_window();
+            sender.segments_out().pop();
+            sender.ack_received(sender.next_seqno(), 10000);
+            sender.stream_in().write(string(10000, 'x'));
+            sender.fill_window();
+            test_err_if(sender.segments_out().size() != 10, "ten MSS-sized segments expected");
+            test_err_if(sender.segments_out().front().gso_size() != 0, "regular segments have no GSO size");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+#include "parser.hh"
+#include "tcp_config.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "tcp_sender.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    try {
+        {
+            // an MSS option survives a serialize/parse round trip
+            TCPSegment seg;
+            seg.header().syn = true;
+            seg.header().mss = 1460;
+            seg.header().doff = (TCPHeader::LENGTH + seg.header().options_length()) / 4;
+            test_err_if(seg.header().doff != 6, "MSS option should take one extra header word");
+
+            TCPSegment parsed;
+            test_err_if(parsed.parse(seg.serialize().concatenate()) != ParseResult::NoError, "parse failed");
+            test_err_if(parsed.header().mss != optional<uint16_t>{1460}, "MSS option was not parsed back");
+            test_err_if(parsed.header().doff != 6, "doff changed in round trip");
+        }
+
+        {
+            // an option that does not fit in doff is dropped, not written past the header
+            TCPSegment seg;
+            seg.header().mss = 1460;
+            seg.header().doff = 5;
+            TCPSegment parsed;
+            test_err_if(parsed.parse(seg.serialize().concatenate()) != ParseResult::NoError, "parse failed");
+            test_err_if(parsed.header().mss.has_value(), "MSS option should not be written when it does not fit");
+        }
+
+        {
+            // NOPs and unknown options are skipped; the MSS option after them is still found
+            TCPHeader header;
+            header.doff = 8;
+            string raw = header.serialize();
+            const string options{"\x01\x01\x08\x06\xaa\xbb\xcc\xdd\x02\x04\x05\xb4", 12};
+            raw.replace(TCPHeader::LENGTH, options.size(), options);
+            TCPHeader parsed;
+            NetParser p{string(raw)};
+            test_err_if(parsed.parse(p) != ParseResult::NoError, "parse with options failed");
+            test_err_if(parsed.mss != optional<uint16_t>{1460}, "MSS option after other options not found");
+
+            // a truncated option list is ignored rather than read past the header
+            raw[TCPHeader::LENGTH + 3] = 40;
+            NetParser p_bad{string(raw)};
+            test_err_if(parsed.parse(p_bad) != ParseResult::NoError, "parse with bad option length failed");
+            test_err_if(parsed.mss.has_value(), "MSS option after a malformed option should be ignored");
+        }
+
+        {
+            // the sender advertises its MSS on the SYN and segments by the smaller of its own and the peer's
+            TCPConfig cfg;
+            cfg.max_payload_size = 3000;
+            TCPSender sender{cfg};
+            sender.fill_window();
+            test_err_if(sender.segments_out().front().header().mss != optional<uint16_t>{3000}, "SYN should carry MSS");
+            sender.segments_out().pop();
+            sender.set_peer_mss(2000);
+            test_err_if(sender.max_payload_size() != 2000, "peer MSS should lower the payload size");
+            sender.set_peer_mss(60000);
+            test_err_if(sender.max_payload_size() != 3000, "peer MSS should not raise the payload size");
+
+            sender.stream_in().write(string(10000, 'x'));
+            sender.ack_received(WrappingInt32{sender.next_seqno()}, 10000);
+            test_err_if(sender.segments_out().size() != 4, "10000 bytes should take four 3000-byte segments");
+            test_err_if(sender.segments_out().front().payload().size() != 3000, "segment should be MSS-sized");
+            test_err_if(sender.segments_out().front().header().mss.has_value(), "only the SYN carries the MSS");
+        }
+
+        {
+            // jumbo payloads are clamped to what still fits in one datagram
+            TCPConfig cfg;
+            cfg.max_payload_size = TCPConfig::MAX_JUMBO_PAYLOAD_SIZE;
+            test_err_if(TCPSender{cfg}.max_payload_size() != TCPConfig::MAX_JUMBO_PAYLOAD_SIZE, "jumbo MSS rejected");
+            cfg.max_payload_size = numeric_limits<uint16_t>::max();
+            test_err_if(TCPSender{cfg}.max_payload_size() != TCPConfig::MAX_JUMBO_PAYLOAD_SIZE,
+                        "an MSS that no datagram can carry should be clamped");
+            cfg.max_payload_size = 1 << 20;
+            test_err_if(TCPSender{cfg}.max_payload_size() != TCPConfig::MAX_JUMBO_PAYLOAD_SIZE,
+                        "MSS should be clamped");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,219 @@
+#include "parser.hh"
+#include "sender_harness.hh"
+#include "tcp_config.hh"
+#include "tcp_header.hh"
+#include "tcp_receiver.hh"
+#include "tcp_segment.hh"
+#include "tcp_sender.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+static TCPSegment data_segment(const WrappingInt32 seqno, const string &data) {
+    TCPSegment seg;
+    seg.header().seqno = seqno;
+    seg.payload() = Buffer{string(data)};
+    return seg;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            // SACK-permitted and SACK blocks survive a serialize/parse round trip
+            TCPSegment seg;
+            seg.header().syn = true;
+            seg.header().mss = 1460;
+            seg.header().sack_permitted = true;
+            seg.header().sack = {{WrappingInt32{100}, WrappingInt32{200}}, {WrappingInt32{300}, WrappingInt32{400}}};
+            seg.header().doff = (TCPHeader::LENGTH + seg.header().options_length()) / 4;
+            test_err_if(seg.header().doff != 5 + 1 + 1 + 5, "MSS, SACK-permitted and two SACK blocks take 7 words");
+
+            TCPSegment parsed;
+            test_err_if(parsed.parse(seg.serialize().concatenate()) != ParseResult::NoError, "parse failed");
+            const TCPHeader &h = parsed.header();
+            test_err_if(h.mss != optional<uint16_t>{1460} or not h.sack_permitted, "SYN options were not parsed back");
+            test_err_if(h.sack.size() != 2 or h.sack[0].left != WrappingInt32{100} or
+                            h.sack[1].right != WrappingInt32{400},
+                        "SACK blocks were not parsed back");
+        }
+
+        {
+            // the receiver reports the reassembler's pending intervals, most recent first
+            TCPReceiver receiver{1000};
+            const WrappingInt32 isn(rd());
+            TCPSegment syn;
+            syn.header().syn = true;
+            syn.header().seqno = isn;
+            receiver.segment_received(syn);
+            test_err_if(not receiver.sack_blocks(4).empty(), "nothing is out of order yet");
+
+            receiver.segment_received(data_segment(isn + 3, "cd"));
+            receiver.segment_received(data_segment(isn + 8, "h"));
+            const auto blocks = receiver.sack_blocks(4);
+            test_err_if(blocks.size() != 2, "two out-of-order ranges expected");
+            test_err_if(blocks[0].left != isn + 8 or blocks[0].right != isn + 9, "most recent range should come first");
+            test_err_if(blocks[1].left != isn + 3 or blocks[1].right != isn + 5, "older range should follow");
+            test_err_if(receiver.sack_blocks(1).size() != 1, "block count should be limited");
+
+            receiver.segment_received(data_segment(isn + 1, "ab"));
+            const auto after = receiver.sack_blocks(4);
+            test_err_if(after.size() != 1 or after[0].left != isn + 8, "assembled range should no longer be reported");
+        }
+
+        {
+            // SACK is offered on the SYN and used only if the peer offers it too
+            TCPConfig cfg;
+            cfg.sack = true;
+            TCPSender sender{cfg};
+            sender.fill_window();
+            test_err_if(not sender.segments_out().front().header().sack_permitted, "SYN should offer SACK");
+            sender.set_peer_sack_permitted(false);
+            test_err_if(sender.sack_permitted(), "SACK should be off when the peer does not offer it");
+
+            TCPSender plain{TCPConfig{}};
+            plain.fill_window();
+            test_err_if(plain.segments_out().front().header().sack_permitted, "SACK is not offered by default");
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.sack = true;
+
+            TCPSenderTestHarness test{"SACK recovery retransmits every hole in one round trip", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+            for (const char *data : {"a", "b", "c", "d", "e", "f"}) {
+                test.execute(WriteBytes{string(data)});
+                test.execute(ExpectSegment{}.with_data(data));
+            }
+            // "b" and "d" are lost
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000));
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000).with_sack(isn + 3, isn + 4));
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000).with_sack(isn + 5, isn + 6).with_sack(
+                isn + 3, isn + 4));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000).with_sack(isn + 5, isn + 7).with_sack(
+                isn + 3, isn + 4));
+            test.execute(ExpectSegment{}.with_data("b").with_seqno(isn + 2));
+            test.execute(ExpectSegment{}.with_data("d").with_seqno(isn + 4));
+            test.execute(ExpectNoSegment{});
+            test.execute(ExpectFastRecovery{true});
+            // sacked segments are never retransmitted, and holes are not retransmitted twice
+            test.execute(AckReceived{WrappingInt32{isn + 2}}.with_win(1000).with_sack(isn + 5, isn + 7).with_sack(
+                isn + 3, isn + 4));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 4}}.with_win(1000).with_sack(isn + 5, isn + 7));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 7}}.with_win(1000));
+            test.execute(ExpectFastRecovery{false});
+            test.execute(ExpectBytesInFlight{0});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.sack = true;
+
+            TCPSenderTestHarness test{"ACKs that SACK new data are duplicates even if the window changed", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+            for (const char *data : {"a", "b", "c", "d"}) {
+                test.execute(WriteBytes{string(data)});
+                test.execute(ExpectSegment{}.with_data(data));
+            }
+            // "a" is lost; the receiver's application reads between the ACKs, changing the window
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(999).with_sack(isn + 2, isn + 3));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(998).with_sack(isn + 2, isn + 4));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(997).with_sack(isn + 2, isn + 5));
+            test.execute(ExpectSegment{}.with_data("a").with_seqno(isn + 1));
+            test.execute(ExpectFastRecovery{true});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.sack = true;
+            cfg.rt_timeout = 100;
+
+            TCPSenderTestHarness test{"After a timeout, ACKs keep repairing the holes below the recovery point", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+            for (const char *data : {"a", "b", "c", "d", "e"}) {
+                test.execute(WriteBytes{string(data)});
+                test.execute(ExpectSegment{}.with_data(data));
+            }
+            // "a" and "c" are lost, along with every ACK, until the timer fires
+            test.execute(Tick{100});
+            test.execute(ExpectSegment{}.with_data("a").with_seqno(isn + 1));
+            test.execute(AckReceived{WrappingInt32{isn + 3}}.with_win(1000).with_sack(isn + 4, isn + 6));
+            test.execute(ExpectSegment{}.with_data("c").with_seqno(isn + 3));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 6}}.with_win(1000));
+            test.execute(ExpectBytesInFlight{0});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.sack = true;
+            cfg.rt_timeout = 100;
+            cfg.congestion_control = TCPConfig::CongestionAlgorithm::NewReno;
+
+            TCPSenderTestHarness test{"A partly acknowledged head segment is repaired from the ackno", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(5000));
+            test.execute(WriteBytes{string(3000, 'x')});
+            for (uint32_t i = 0; i < 3; i++) {
+                test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 1 + 1000 * i));
+            }
+            test.execute(Tick{100});
+            test.execute(ExpectSegment{}.with_payload_size(1000).with_seqno(isn + 1));
+            // the peer's window cut the head segment short: it holds half of it, and SACKs the rest
+            test.execute(AckReceived{WrappingInt32{isn + 501}}.with_win(5000).with_sack(isn + 1001, isn + 3001));
+            test.execute(ExpectSegment{}.with_payload_size(500).with_seqno(isn + 501));
+            test.execute(ExpectNoSegment{});
+            test.execute(AckReceived{WrappingInt32{isn + 3001}}.with_win(5000));
+            test.execute(ExpectBytesInFlight{0});
+        }
+
+        {
+            TCPConfig cfg;
+            WrappingInt32 isn(rd());
+            cfg.fixed_isn = isn;
+            cfg.fast_retransmit = true;
+
+            TCPSenderTestHarness test{"SACK blocks are ignored unless SACK is enabled", cfg};
+            test.execute(ExpectSegment{}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+            test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000));
+            for (const char *data : {"a", "b", "c", "d"}) {
+                test.execute(WriteBytes{string(data)});
+                test.execute(ExpectSegment{}.with_data(data));
+            }
+            for (int i = 0; i < 4; i++) {
+                test.execute(AckReceived{WrappingInt32{isn + 1}}.with_win(1000).with_sack(isn + 4, isn + 5));
+            }
+            test.execute(ExpectSegment{}.with_data("a"));
+            test.execute(ExpectNoSegment{});
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,158 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// move every pending segment from x to y, keeping a copy of each
+static vector<TCPSegment> deliver(TCPConnection &x, TCPConnection &y) {
+    vector<TCPSegment> delivered;
+    while (not x.segments_out().empty()) {
+        delivered.push_back(x.segments_out().front());
+        x.segments_out().pop();
+        y.segment_received(delivered.back());
+    }
+    return delivered;
+}
+
+// drop every pending segment of x, returning them
+static vector<TCPSegment> drop(TCPConnection &x) {
+    vector<TCPSegment> dropped;
+    while (not x.segments_out().empty()) {
+        dropped.push_back(x.segments_out().front());
+        x.segments_out().pop();
+    }
+    return dropped;
+}
+
+int main() {
+    try {
+        {
+            // the timestamps option survives a serialize/parse round trip next to the other SYN options
+            TCPSegment seg;
+            seg.header().syn = true;
+            seg.header().mss = 1460;
+            seg.header().sack_permitted = true;
+            seg.header().wscale = 7;
+            seg.header().timestamps = TCPTimestamps{0x12345678, 0x9abcdef0};
+            seg.header().doff = (TCPHeader::LENGTH + seg.header().options_length()) / 4;
+            test_err_if(seg.header().doff != 5 + 6, "MSS, SACK-permitted, window scale and timestamps take 6 words");
+
+            TCPSegment parsed;
+            test_err_if(parsed.parse(seg.serialize().concatenate()) != ParseResult::NoError, "parse failed");
+            const TCPHeader &h = parsed.header();
+            test_err_if(not h.timestamps.has_value() or h.timestamps->tsval != 0x12345678 or
+                            h.timestamps->tsecr != 0x9abcdef0,
+                        "timestamps option was not parsed back");
+            test_err_if(h.mss != optional<uint16_t>{1460} or not h.sack_permitted or h.wscale != optional<uint8_t>{7},
+                        "other SYN options were lost");
+        }
+
+        TCPConfig cfg;
+        cfg.timestamps = true;
+
+        {
+            // both ends offer timestamps: every segment carries them, and each side echoes the other's clock
+            TCPConnection x{cfg}, y{cfg};
+
+            x.connect();
+            y.tick(7);
+            const auto syn = deliver(x, y);
+            test_err_if(not syn.front().header().timestamps.has_value(), "SYN should offer timestamps");
+            x.tick(40);
+            const auto syn_ack = deliver(y, x);
+            test_err_if(not syn_ack.front().header().timestamps.has_value(), "SYN-ACK should offer timestamps too");
+            test_err_if(syn_ack.front().header().timestamps->tsval != 7, "TSval should be the sender's clock");
+            test_err_if(syn_ack.front().header().timestamps->tsecr != syn.front().header().timestamps->tsval,
+                        "SYN-ACK should echo the SYN's timestamp");
+            test_err_if(x.smoothed_rtt() != 40, "the echoed SYN timestamp should give the first RTT sample");
+            deliver(x, y);
+
+            // a retransmitted segment still gives an RTT sample, from the timestamp of the retransmission
+            x.write("hello");
+            const auto lost = drop(x);
+            x.tick(x.retransmission_timeout());
+            y.tick(100);
+            const auto retx = deliver(x, y);
+            test_err_if(retx.size() != 1 or retx.front().payload().copy() != "hello", "data should be retransmitted");
+            test_err_if(retx.front().header().timestamps->tsval <= lost.front().header().timestamps->tsval,
+                        "the retransmission should carry a newer timestamp");
+            x.tick(8);
+            const auto acks = deliver(y, x);
+            test_err_if(acks.back().header().timestamps->tsecr != retx.front().header().timestamps->tsval,
+                        "the ACK should echo the retransmission's timestamp");
+            test_err_if(x.smoothed_rtt() >= 40, "the 8 ms sample of the retransmission should lower the smoothed RTT");
+
+            // PAWS: the lost original turns up late, after the newer timestamp was seen, and is ignored
+            // even though its sequence numbers are now acceptable
+            const size_t buffered = y.inbound_stream().buffer_size();
+            TCPSegment old = lost.front();
+            old.header().seqno = old.header().seqno + 5;
+            y.segment_received(old);
+            test_err_if(y.inbound_stream().buffer_size() != buffered, "PAWS should reject the old segment");
+            const auto reply = drop(y);
+            test_err_if(reply.size() != 1 or reply.front().length_in_sequence_space() != 0,
+                        "a rejected segment should be answered with an ACK");
+
+            // the same segment with a current timestamp is accepted
+            old.header().timestamps->tsval = acks.back().header().timestamps->tsecr + 1;
+            y.segment_received(old);
+            test_err_if(y.inbound_stream().buffer_size() != buffered + 5,
+                        "a segment with a newer timestamp is accepted");
+
+            // a duplicate of data already acknowledged is outside the window: its timestamp must not become
+            // TS.Recent, even though it starts before the last ACK sent
+            drop(y);
+            TCPSegment duplicate = retx.front();
+            duplicate.header().timestamps->tsval = old.header().timestamps->tsval + 1000;
+            y.segment_received(duplicate);
+            const auto dup_ack = drop(y);
+            test_err_if(dup_ack.empty() or dup_ack.back().header().timestamps->tsecr != old.header().timestamps->tsval,
+                        "an out-of-window segment should not update TS.Recent");
+        }
+
+        {
+            // only one end offers timestamps: neither side sends them after the handshake
+            TCPConnection x{cfg}, y{TCPConfig{}};
+
+            x.connect();
+            deliver(x, y);
+            const auto syn_ack = deliver(y, x);
+            test_err_if(syn_ack.front().header().timestamps.has_value(),
+                        "peer without timestamps should not offer them");
+            x.write("data");
+            const auto data = deliver(x, y);
+            test_err_if(data.front().header().timestamps.has_value(),
+                        "timestamps should not be used unless both agree");
+
+            // a peer that sends timestamps anyway is not subject to PAWS: the option is ignored
+            x.write("more");
+            x.write("again");
+            vector<TCPSegment> unagreed = drop(x);
+            unagreed.at(0).header().timestamps = TCPTimestamps{1000, 0};
+            unagreed.at(1).header().timestamps = TCPTimestamps{500, 0};
+            const size_t buffered = y.inbound_stream().buffer_size();
+            y.segment_received(unagreed[0]);
+            y.segment_received(unagreed[1]);
+            test_err_if(y.inbound_stream().buffer_size() != buffered + 9,
+                        "timestamps that were not negotiated should not reject a segment");
+            test_err_if(y.segments_out().back().header().timestamps.has_value(),
+                        "timestamps that were not negotiated should not be echoed");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
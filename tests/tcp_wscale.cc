@@ -0,0 +1,97 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// move every pending segment from x to y, keeping a copy of each
+static vector<TCPSegment> deliver(TCPConnection &x, TCPConnection &y) {
+    vector<TCPSegment> delivered;
+    while (not x.segments_out().empty()) {
+        delivered.push_back(x.segments_out().front());
+        x.segments_out().pop();
+        y.segment_received(delivered.back());
+    }
+    return delivered;
+}
+
+int main() {
+    try {
+        {
+            // the window scale option survives a serialize/parse round trip
+            TCPSegment seg;
+            seg.header().syn = true;
+            seg.header().mss = 1460;
+            seg.header().wscale = 7;
+            seg.header().doff = (TCPHeader::LENGTH + seg.header().options_length()) / 4;
+            test_err_if(seg.header().doff != 7, "MSS and window scale should take two extra header words");
+
+            TCPSegment parsed;
+            test_err_if(parsed.parse(seg.serialize().concatenate()) != ParseResult::NoError, "parse failed");
+            test_err_if(parsed.header().wscale != optional<uint8_t>{7}, "window scale option was not parsed back");
+            test_err_if(parsed.header().mss != optional<uint16_t>{1460}, "MSS option was lost");
+        }
+
+        {
+            // both ends offer scaling: windows above 64 KiB are advertised and used
+            TCPConfig cfg;
+            cfg.window_scaling = true;
+            cfg.recv_capacity = cfg.send_capacity = 1024 * 1024;
+            TCPConnection x{cfg}, y{cfg};
+
+            x.connect();
+            const auto syn = deliver(x, y);
+            test_err_if(syn.front().header().wscale != optional<uint8_t>{5}, "1 MiB needs a shift of 5");
+            test_err_if(syn.front().header().win != 65535, "the window in a SYN is never scaled");
+            const auto syn_ack = deliver(y, x);
+            test_err_if(syn_ack.front().header().wscale != optional<uint8_t>{5}, "SYN-ACK should offer scaling too");
+
+            x.write(string(500000, 'x'));
+            deliver(x, y);
+            test_err_if(x.bytes_in_flight() != 65535, "until the first scaled ACK, the SYN-ACK's window applies");
+            const auto acks = deliver(y, x);
+            test_err_if(acks.back().header().win != (1024 * 1024 - 65535) >> 5, "window should be scaled down by 5");
+            test_err_if(acks.back().header().wscale.has_value(), "only the SYN carries the window scale");
+            test_err_if(x.bytes_in_flight() != 500000 - 65535, "scaled window should let the rest be sent at once");
+            deliver(x, y);
+            deliver(y, x);
+            test_err_if(x.bytes_in_flight() != 0, "all data should be acknowledged");
+        }
+
+        {
+            // only one end offers scaling: neither side scales
+            TCPConfig cfg;
+            cfg.window_scaling = true;
+            cfg.recv_capacity = cfg.send_capacity = 1024 * 1024;
+            TCPConfig plain_cfg;
+            plain_cfg.recv_capacity = plain_cfg.send_capacity = 1024 * 1024;
+            TCPConnection x{cfg}, y{plain_cfg};
+
+            x.connect();
+            deliver(x, y);
+            const auto syn_ack = deliver(y, x);
+            test_err_if(syn_ack.front().header().wscale.has_value(), "peer without scaling should not offer it");
+
+            x.write(string(500000, 'x'));
+            deliver(x, y);
+            test_err_if(x.bytes_in_flight() != 65535, "unscaled window should cap the flight at 65535 bytes");
+            const auto acks = deliver(y, x);
+            test_err_if(acks.back().header().win != 65535, "unscaled window should saturate at 65535");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
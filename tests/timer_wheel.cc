@@ -0,0 +1,72 @@
+#include "test_err_if.hh"
+#include "timer_wheel.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        {
+            // timers on every level, and beyond the last one, each fire once, exactly at their expiry
+            TimerWheel<size_t> wheel;
+            vector<uint64_t> expiry;
+            for (const uint64_t range : {64ul, 4096ul, 262144ul, 16777216ul, 40000000ul}) {
+                for (size_t i = 0; i < 2000; i++) {
+                    expiry.push_back(1 + rd() % range);
+                    wheel.schedule(expiry.back(), expiry.size() - 1);
+                }
+            }
+            test_err_if(wheel.size() != expiry.size(), "every timer should be waiting");
+
+            vector<size_t> fired(expiry.size());
+            uint64_t last = 0;
+            while (wheel.size() > 0) {
+                wheel.advance(wheel.now() + 1 + rd() % 5000, [&](const uint64_t when, const size_t index) {
+                    test_err_if(when != expiry[index] or wheel.now() != when, "a timer fired at the wrong time");
+                    test_err_if(when < last, "timers should fire in order of expiry");
+                    last = when;
+                    fired[index]++;
+                });
+            }
+            for (const size_t count : fired) {
+                test_err_if(count != 1, "every timer should fire exactly once");
+            }
+        }
+
+        {
+            // a timer scheduled from a firing timer, or already due, fires on a later advance()
+            TimerWheel<int> wheel;
+            wheel.advance(1000, [](uint64_t, int) { throw runtime_error("nothing is scheduled"); });
+            wheel.schedule(500, 1);
+            wheel.schedule(1010, 2);
+            vector<pair<uint64_t, int>> fired;
+            const auto record = [&](const uint64_t, const int payload) {
+                fired.emplace_back(wheel.now(), payload);
+                if (payload == 2) {
+                    wheel.schedule(wheel.now() + 100, 3);
+                }
+            };
+            wheel.advance(1001, record);
+            test_err_if(fired.size() != 1 or fired[0] != make_pair(1001ul, 1), "an overdue timer should fire next");
+            wheel.advance(1009, record);
+            test_err_if(fired.size() != 1, "nothing should fire before its expiry");
+            wheel.advance(2000, record);
+            test_err_if(fired.size() != 3 or fired[1] != make_pair(1010ul, 2) or fired[2] != make_pair(1110ul, 3),
+                        "the rescheduled timer should fire in the same advance()");
+            test_err_if(wheel.size() != 0, "no timers should be left");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}